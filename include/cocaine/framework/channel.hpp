@@ -16,9 +16,16 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+#include <system_error>
 #include <tuple>
 
+#include <asio/error.hpp>
+
+#include <cocaine/idl/streaming.hpp>
 #include <cocaine/rpc/protocol.hpp>
+#include <cocaine/traits/error_code.hpp>
 
 #include <cocaine/framework/forwards.hpp>
 
@@ -26,6 +33,42 @@ namespace cocaine {
 
 namespace framework {
 
+namespace detail {
+
+/// Makes channels of the given dispatch protocol cancellable remotely.
+///
+/// The protocol has no dedicated cancellation message, so only channels, which dispatch protocol
+/// is streaming, can be cancelled by sending its error message, unless the client has closed the
+/// stream already. Other channels are only revoked locally.
+///
+/// \internal
+template<class Dispatch>
+struct cancel_traits {
+    template<class Session>
+    static
+    void
+    apply(const std::shared_ptr<basic_sender_t<Session>>&, basic_receiver_t<Session>&, bool) {}
+};
+
+/// \internal
+template<class T>
+struct cancel_traits<io::streaming_tag<T>> {
+    template<class Session>
+    static
+    void
+    apply(const std::shared_ptr<basic_sender_t<Session>>& tx, basic_receiver_t<Session>& rx, bool abandoned) {
+        typedef typename io::protocol<io::streaming_tag<T>>::scope::error event_type;
+
+        rx.cancellable([tx]() -> task<void>::future_type {
+            return tx->template interrupt<event_type>(
+                std::error_code(asio::error::operation_aborted), std::string("cancelled by the client")
+            );
+        }, abandoned);
+    }
+};
+
+} // namespace detail
+
 /// The channel class represents a named tuple channel.
 ///
 /// Channels are always associated with some concrete Event.
@@ -47,6 +90,14 @@ struct channel {
         tx(std::move(std::get<0>(tuple))),
         rx(std::move(std::get<1>(tuple)))
     {}
+
+    /// Cancels the channel, see basic_receiver_t::cancel.
+    ///
+    /// \warning the receiver part will be invalidated after this call unless it is a streaming
+    /// one.
+    auto cancel() -> task<void>::future_type {
+        return rx.cancel();
+    }
 };
 
 } // namespace framework
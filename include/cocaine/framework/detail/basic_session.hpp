@@ -16,22 +16,30 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
-#include <unordered_map>
+#include <functional>
+#include <map>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 
+#include <asio/generic/stream_protocol.hpp>
 #include <asio/ip/tcp.hpp>
 
 #include <cocaine/common.hpp>
 #include <cocaine/locked_ptr.hpp>
-#include <cocaine/rpc/asio/transport.hpp>
 
 #include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/forwards.hpp"
 #include "cocaine/framework/receiver.hpp"
+#include "cocaine/framework/socket_options.hpp"
 
+#include "cocaine/framework/detail/channel_table.hpp"
 #include "cocaine/framework/detail/decoder.hpp"
+#include "cocaine/framework/detail/endpoint_stats.hpp"
+#include "cocaine/framework/detail/transport.hpp"
+#include "cocaine/framework/detail/zone.hpp"
 
 namespace cocaine { namespace framework {
 
@@ -51,23 +59,24 @@ class basic_session_t:
 {
     /// Transport types.
     ///
-    /// We use the pure ASIO internally, because Cocaine API uses and exports it.
-    typedef asio::ip::tcp protocol_type;
+    /// We use the pure ASIO internally, because Cocaine API uses and exports it. The generic
+    /// protocol carries both TCP and local endpoints, so the same session reaches co-located
+    /// services over local sockets.
+    typedef asio::generic::stream_protocol protocol_type;
     typedef protocol_type::socket socket_type;
-    typedef io::transport<protocol_type, io::encoder_t, detail::decoder_t> transport_type;
-
-    typedef std::unordered_map<
-        std::uint64_t,
-        std::shared_ptr<shared_state_t>
-    > channel_map_type;
+    typedef detail::transport_t<protocol_type> transport_type;
 
     class push_t;
+    class connect_t;
 
 public:
     typedef boost::asio::ip::tcp::endpoint endpoint_type;
+    typedef boost::asio::local::stream_protocol::endpoint local_endpoint_type;
 
     typedef socket_type::native_handle_type native_handle_type;
 
+    typedef std::function<void(const std::error_code&)> disconnect_handler_type;
+
     typedef std::tuple<
         std::shared_ptr<basic_sender_t<basic_session_t>>,
         std::shared_ptr<basic_receiver_t<basic_session_t>>
@@ -88,13 +97,58 @@ private:
 
     std::atomic<int> state;
     std::atomic<std::uint64_t> counter;
-    decoded_message message;
+
+    /// Messages decoded by a single read, their spans and channel states, reused between reads.
+    std::vector<decoded_message> messages;
+    std::vector<std::uint64_t> spans;
+    std::vector<std::shared_ptr<shared_state_t>> states;
 
     synchronized<std::shared_ptr<transport_type>> transport;
-    synchronized<channel_map_type> channels;
+
+    /// The endpoint of the current connection, protected by the transport lock.
+    protocol_type::endpoint remote;
+    detail::endpoint_stats_t stats;
+
+    /// Frames queued while connecting with their write promises, protected by the transport lock.
+    std::vector<std::pair<frame_t, promise<void>>> backlog;
+    detail::channel_table_t channels;
+
+    /// Writer cork bounds, protected by the transport lock.
+    std::size_t cork_bytes;
+    std::chrono::microseconds cork_latency;
+
+    /// Writer queue watermarks, protected by the transport lock.
+    std::size_t high_watermark;
+    std::size_t low_watermark;
+
+    /// Socket options, protected by the transport lock.
+    socket_options_t socket_options_;
+    /// Number of data reads of the current transport, after which TCP_QUICKACK has been set last
+    /// time, protected by the transport lock.
+    std::uint64_t quickacked;
+
+    /// Handler invoked when the established connection breaks, protected by the transport lock.
+    disconnect_handler_type disconnect_handler_;
 
     std::atomic<bool> hard_shutdown_;
+    std::atomic<bool> cancel_abandoned_;
+    std::atomic<bool> replay_;
+    std::atomic<bool> retain_replays_;
+
+    /// Frames of idempotent invocations, which have not received any response yet, and the ones
+    /// waiting to be sent again after the connection broke, protected by the replay lock.
+    ///
+    /// The lock is never held while acquiring other ones.
+    std::mutex replay_mutex;
+    std::map<std::uint64_t, frame_t> replays;
+    std::map<std::uint64_t, frame_t> replaying;
+    /// Total number of frames in both maps, allows to skip the lock when there are none.
+    std::atomic<std::size_t> replayable;
 
+    /// Number of received messages dropped, because their channels were revoked.
+    std::atomic<std::uint64_t> orphans_;
+
+    /// Orders span allocation with queueing the invocation frames.
     std::mutex mutex;
 
 public:
@@ -114,25 +168,165 @@ public:
     bool
     connected() const noexcept;
 
+    /// Checks whether the session is connecting.
+    ///
+    /// Messages sent in this state are queued and written as soon as the connection is
+    /// established, or fail if it is not.
+    bool
+    connecting() const noexcept;
+
+    /// Returns the number of channels waiting for their responses.
+    ///
+    /// Mute invocations have no channel, so their in-flight writes are not counted.
+    ///
+    /// \threadsafe
+    std::size_t
+    load() const noexcept;
+
     /// \threadsafe
     future<std::error_code>
     connect(const endpoint_type& endpoint);
 
+    /// Connects to one of the given endpoints.
+    ///
+    /// Endpoints are tried one by one, healthy ones first, from the fastest to the slowest
+    /// according to the statistics of previous connects, see endpoint_stats.
+    ///
     /// \threadsafe
     auto connect(const std::vector<endpoint_type>& endpoints) -> task<std::error_code>::future_type;
 
+    /// Connects to the local socket bound to the given path.
+    ///
+    /// Local sockets bypass the loopback TCP stack, which is noticeably faster for small messages
+    /// exchanged with services on the same host. TCP socket options are ignored for such
+    /// connections.
+    ///
+    /// \threadsafe
+    future<std::error_code>
+    connect(const local_endpoint_type& endpoint);
+
     auto hard_shutdown(bool policy) -> void;
 
-    /// Returns the endpoint of the connected peer if the session is in connected state; otherwise
-    /// returns none.
+    /// Sets whether channels are cancelled when their receivers are destroyed before the service
+    /// has finished them, see basic_receiver_t::cancel.
+    ///
+    /// \threadsafe
+    void
+    cancel_abandoned(bool policy) noexcept;
+
+    bool
+    cancels_abandoned() const noexcept;
+
+    /// Sets whether idempotent invocations are replayed after the connection breaks.
+    ///
+    /// Channels of such invocations, which have not received any response yet, survive the broken
+    /// connection and their frames are sent again on the next successful connect, before anything
+    /// else. If that connect fails, the channels fail with its error unless they are retained, see
+    /// retain_replays. Disabled by default.
+    ///
+    /// The policy applies to channels invoked afterwards.
+    ///
+    /// \threadsafe
+    void
+    replay(bool policy) noexcept;
+
+    /// Sets whether channels waiting for the replay survive failed connects.
+    ///
+    /// Set by the owner, which reconnects the session in the background, so the replay waits for
+    /// the attempt which succeeds. The owner fails such channels with abandon_replays when it stops
+    /// reconnecting. Channels with deadlines still expire meanwhile.
+    ///
+    /// \threadsafe
+    void
+    retain_replays(bool policy) noexcept;
+
+    /// Fails the channels waiting for the replay with the given error.
+    ///
+    /// \threadsafe
+    void
+    abandon_replays(const std::error_code& ec);
+
+    /// Sets the handler, which is invoked on the event loop each time the established connection
+    /// breaks.
+    ///
+    /// \threadsafe
+    void
+    disconnect_handler(disconnect_handler_type handler);
+
+    /// Returns the number of received messages dropped, because their channels were revoked.
+    ///
+    /// Such messages are usually responses to channels cancelled or expired on the client side,
+    /// which the service has sent before handling the cancellation.
+    ///
+    /// \threadsafe
+    std::uint64_t
+    orphans() const noexcept;
+
+    /// Sets the outbound cork bounds.
+    ///
+    /// Messages sent while the connection is idle are held until either the given number of bytes
+    /// is queued or the given latency passes, and then written at once. Zero latency, which is the
+    /// default, disables corking. Messages sent while a write is in progress are always gathered
+    /// into the next write.
+    ///
+    /// \threadsafe
+    void
+    cork(std::size_t bytes, std::chrono::microseconds latency);
+
+    /// Sets the socket options.
+    ///
+    /// The options are applied to the current connection, if any, and to the further ones before
+    /// connecting.
+    ///
+    /// \threadsafe
+    void
+    socket_options(const socket_options_t& options);
+
+    /// Sets the outbound queue watermarks.
+    ///
+    /// When more than `high` bytes are queued for writing, completion of sent messages futures is
+    /// delayed until the queue drains to `low` bytes, so producers waiting for them are slowed down
+    /// to the socket speed. Zero high watermark, which is the default, disables throttling.
+    ///
+    /// \threadsafe
+    void
+    watermarks(std::size_t high, std::size_t low);
+
+    /// Returns a future, which becomes ready when the outbound queue is not throttled by the high
+    /// watermark.
+    ///
+    /// The future throws std::system_error if the session is not connected or the connection has
+    /// been broken.
+    ///
+    /// \threadsafe
+    future<void>
+    writable();
+
+    /// Returns the endpoint of the connected peer if the session is in connected state over TCP;
+    /// otherwise returns none.
     ///
     /// \threadsafe
     boost::optional<endpoint_type>
     endpoint() const;
 
+    /// Returns the average connect round-trip time in microseconds and the error rate of the given
+    /// endpoint, which are zeros if the session has never tried it.
+    ///
+    /// \threadsafe
+    detail::endpoint_stats_t::stats_t
+    endpoint_stats(const endpoint_type& endpoint) const;
+
     native_handle_type
     native_handle() const;
 
+    /// Returns hit/miss counters of the message zone pool of the current connection.
+    ///
+    /// Counters are reset on reconnection. Returns zeros if the session is not connected.
+    ///
+    /// \threadsafe
+    detail::zone_pool_t::stats_t
+    zone_stats() const;
+
     /// Cancels the current session, moving it to the disconnected unrecoverable state.
     ///
     /// \warning the session becomes invalid after this call, its further external usage will
@@ -142,6 +336,9 @@ public:
 
     /// Sends an invocation event and creates a new channel accociated with it.
     ///
+    /// The encode callback is invoked once, with a provisional span, and the frame it returns is
+    /// rebound to the allocated span. Such frames must be built by the framework encoders.
+    ///
     /// \note if the future returned throws an exception that means that the data will never be
     /// received, but if it doesn't - the data is not guaranteed to be received. It is possible for
     /// the other end of connection to hang up immediately after the future returns ok.
@@ -149,16 +346,36 @@ public:
     /// If you send a **mute** event, there is no way to obtain guarantees of successful message
     /// transporting.
     ///
+    /// If the timeout is given, the channel deadline is set, see basic_receiver_t::deadline.
+    ///
+    /// Idempotent invocations are replayed after the connection breaks if the replay is enabled,
+    /// see replay.
+    ///
     /// \threadsafe
     future<invoke_result>
-    invoke(encode_callback_t encode_callback);
+    invoke(encode_callback_t encode_callback,
+           std::chrono::milliseconds timeout = std::chrono::milliseconds::zero(),
+           bool idempotent = false);
 
-    /// TODO: Implement: invoke_mute - sends an invoke event without channel creation.
+    /// Sends a mute invocation event, which has no response, without creating a channel.
+    ///
+    /// Only the frame is encoded and written, no sender, receiver or channel state is allocated.
+    /// The returned future is set when the frame is written or the write fails.
+    ///
+    /// \threadsafe
+    future<void>
+    invoke_mute(encode_callback_t encode_callback);
 
     /// Sends an event without creating a new channel.
     future<void>
     push(io::encoder_t::message_type&& message);
 
+    /// Sends an encoded frame without creating a new channel.
+    ///
+    /// Payload regions the frame references are kept alive until the frame is written.
+    future<void>
+    push(frame_t&& frame);
+
     /*!
      * Unsubscribes a channel with the given span.
      *
@@ -166,21 +383,56 @@ public:
      */
     void revoke(std::uint64_t span);
 
+    /// Schedules the callback on the event loop timer wheel.
+    ///
+    /// \threadsafe
+    std::shared_ptr<detail::deadline_t>
+    schedule(std::chrono::milliseconds timeout, std::function<void()> callback);
+
 private:
     /// Called on socket connect event.
     void
-    on_connect(const std::error_code& ec, promise<std::error_code> pr, std::unique_ptr<socket_type>& socket);
+    on_connect(const std::error_code& ec, const protocol_type::endpoint& endpoint, promise<std::error_code> pr, std::unique_ptr<socket_type>& socket);
 
-    /// Called on socket read event.
+    /// Moves the connecting session back to the disconnected state, failing the frames queued while
+    /// connecting and the channels waiting for them.
     void
-    on_read(const std::error_code& ec);
+    on_connect_failed(const std::error_code& ec);
+
+    /// Connects to one of the given endpoints, see the public overloads.
+    future<std::error_code>
+    connect(std::vector<protocol_type::endpoint> endpoints);
 
-    /// Called on socket error while handling read or write event.
+    /// Called on socket read event of the given transport with a batch of decoded messages.
+    void
+    on_read(const std::error_code& ec, const std::weak_ptr<transport_type>& from);
+
+    /// Called on socket error while handling read or write event of the given transport.
+    ///
+    /// Drops the transport if it is the current one, moving the session to the disconnected state,
+    /// so further messages are either queued for the next connect or fail.
     void
-    on_error(const std::error_code& ec);
+    on_error(const std::error_code& ec, const std::weak_ptr<transport_type>& broken);
 
+    /// \pre the transport lock is held.
     void
     pull(std::shared_ptr<transport_type> transport);
+
+    /// Queues the frame, fulfilling the promise after it is written.
+    void
+    push(frame_t&& frame, promise<void> pr);
+
+    /// Allocates the span for the invocation frame and queues it, registering the given channel
+    /// state if any. Keeps a copy of the frame to replay it if asked.
+    ///
+    /// \returns the allocated span.
+    std::uint64_t
+    push_invoke(frame_t&& frame, std::shared_ptr<shared_state_t> state, promise<void> pr, bool replay = false);
+
+    /// Forgets the replay frame of the given span, because the channel has either received a
+    /// response or been revoked.
+    void
+    settle(std::uint64_t span);
 };
 
 }} // namespace cocaine::framework
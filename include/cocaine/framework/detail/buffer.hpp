@@ -0,0 +1,113 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Fixed-size uninitialized byte buffer used as a read buffer by transports.
+///
+/// Decoded messages hold a shared reference to the buffer their frame was parsed from, which
+/// allows to unpack MessagePack objects in place without copying.
+///
+/// \internal
+class buffer_t {
+    std::unique_ptr<char[]> data_;
+    std::size_t size_;
+
+public:
+    explicit
+    buffer_t(std::size_t size) :
+        data_(new char[size]),
+        size_(size)
+    {}
+
+    buffer_t(const buffer_t& other) = delete;
+    buffer_t& operator=(const buffer_t& other) = delete;
+
+    char*
+    data() noexcept {
+        return data_.get();
+    }
+
+    const char*
+    data() const noexcept {
+        return data_.get();
+    }
+
+    std::size_t
+    size() const noexcept {
+        return size_;
+    }
+};
+
+/// Keeps retired read buffers for reuse by all transports of the process.
+///
+/// Streams retire their buffers after being idle for a while, so idle connections hold no read
+/// memory and share the pool instead. A buffer can be retired while some decoded messages still pin
+/// it. Such buffers are handed out again only after all of those messages are destroyed, i.e. when
+/// the pool holds the last reference.
+///
+/// Buffers are kept in buckets by power of two size classes, each with its own lock, so streams
+/// reading at different rates do not contend and a lookup scans only the buffers of a single class.
+///
+/// \internal
+/// \threadsafe
+class buffer_pool_t {
+    struct bucket_t {
+        std::mutex mutex;
+        std::size_t capacity;
+        std::vector<std::shared_ptr<buffer_t>> buffers;
+    };
+
+    enum : std::size_t {
+        /// Size class of the first bucket, as a power of two.
+        min_class = 12,
+        /// Size class of the last bucket, as a power of two. Larger buffers are not kept.
+        max_class = 22
+    };
+
+    std::array<bucket_t, max_class - min_class + 1> buckets;
+
+    buffer_pool_t();
+
+public:
+    /// Returns the process-wide pool.
+    static
+    buffer_pool_t&
+    instance();
+
+    /// Returns a buffer of at least the given size, reusing an unpinned retired one, which is less
+    /// than four times larger.
+    std::shared_ptr<buffer_t>
+    acquire(std::size_t size);
+
+    /// Retires the given buffer.
+    ///
+    /// If its bucket is full or the buffer is too large to be kept, it is dropped, being freed after
+    /// the last message releases it.
+    void
+    release(std::shared_ptr<buffer_t> buffer);
+};
+
+}}} // namespace cocaine::framework::detail
@@ -0,0 +1,201 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "cocaine/framework/forwards.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Maps spans to the states of their channels.
+///
+/// The table is split into shards, each guarded by its own lock. Spans are allocated sequentially,
+/// so consecutive channels fall into different shards and invocations, lookups and revocations
+/// made from different threads rarely contend.
+///
+/// \internal
+/// \threadsafe
+class channel_table_t {
+public:
+    typedef std::shared_ptr<shared_state_t> value_type;
+
+    enum : std::size_t {
+        /// Number of shards, must be the power of two not greater than 32.
+        shards_count = 16
+    };
+
+private:
+    /// Aligned to keep neighbour shards on different cache lines.
+    struct alignas(64) shard_t {
+        std::mutex mutex;
+        std::unordered_map<std::uint64_t, value_type> channels;
+    };
+
+    std::array<shard_t, shards_count> shards;
+    std::atomic<std::size_t> size_;
+
+public:
+    channel_table_t() :
+        size_(0)
+    {}
+
+    void
+    insert(std::uint64_t span, value_type state) {
+        auto& shard = shard_of(span);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.channels.insert(std::make_pair(span, std::move(state))).second) {
+            ++size_;
+        }
+    }
+
+    /// Returns the state of the channel with the given span or nullptr if there is no such channel.
+    value_type
+    find(std::uint64_t span) {
+        auto& shard = shard_of(span);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.channels.find(span);
+        if (it == shard.channels.end()) {
+            return nullptr;
+        }
+
+        return it->second;
+    }
+
+    /// Appends the states of the channels with the given spans to `states` in the same order,
+    /// nullptr for spans without a channel.
+    ///
+    /// Each shard is locked once for the whole batch instead of once per span.
+    void
+    find(const std::vector<std::uint64_t>& spans, std::vector<value_type>& states) {
+        const std::size_t offset = states.size();
+        states.resize(offset + spans.size());
+
+        std::uint32_t pending = 0;
+        for (auto span : spans) {
+            pending |= 1u << index_of(span);
+        }
+
+        for (std::size_t index = 0; pending != 0; ++index, pending >>= 1) {
+            if ((pending & 1) == 0) {
+                continue;
+            }
+
+            auto& shard = shards[index];
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (std::size_t id = 0; id < spans.size(); ++id) {
+                if (index_of(spans[id]) != index) {
+                    continue;
+                }
+
+                auto it = shard.channels.find(spans[id]);
+                if (it != shard.channels.end()) {
+                    states[offset + id] = it->second;
+                }
+            }
+        }
+    }
+
+    /// Removes the channel with the given span.
+    ///
+    /// \returns true if the table has become empty.
+    bool
+    erase(std::uint64_t span) {
+        auto& shard = shard_of(span);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.channels.erase(span) == 0) {
+            return false;
+        }
+
+        return --size_ == 0;
+    }
+
+    bool
+    empty() const noexcept {
+        return size_ == 0;
+    }
+
+    std::size_t
+    size() const noexcept {
+        return size_;
+    }
+
+    /// Removes all channels, returning their states.
+    std::vector<value_type>
+    drain() {
+        std::vector<value_type> states;
+
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto& channel : shard.channels) {
+                states.push_back(std::move(channel.second));
+            }
+
+            size_ -= shard.channels.size();
+            shard.channels.clear();
+        }
+
+        return states;
+    }
+
+    /// Removes all channels but the ones, which spans the given predicate keeps, returning the
+    /// states of the removed ones.
+    template<class Predicate>
+    std::vector<value_type>
+    drain_except(Predicate keep) {
+        std::vector<value_type> states;
+
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (auto it = shard.channels.begin(); it != shard.channels.end();) {
+                if (keep(it->first)) {
+                    ++it;
+                } else {
+                    states.push_back(std::move(it->second));
+                    it = shard.channels.erase(it);
+                    --size_;
+                }
+            }
+        }
+
+        return states;
+    }
+
+private:
+    static
+    std::size_t
+    index_of(std::uint64_t span) noexcept {
+        return span & (shards_count - 1);
+    }
+
+    shard_t&
+    shard_of(std::uint64_t span) noexcept {
+        return shards[index_of(span)];
+    }
+};
+
+}}} // namespace cocaine::framework::detail
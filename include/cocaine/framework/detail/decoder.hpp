@@ -17,7 +17,10 @@
 #pragma once
 
 #include <stddef.h>
+#include <cstdint>
+#include <memory>
 #include <system_error>
+#include <vector>
 
 #include <cocaine/hpack/header.hpp>
 
@@ -29,15 +32,107 @@ class decoded_message;
 
 namespace detail {
 
+class buffer_t;
+class zone_pool_t;
+
+/// Incrementally finds the boundary of the next MessagePack frame.
+///
+/// The scanner remembers how far it has advanced through a partially received frame, so each byte
+/// is inspected once no matter how many reads it takes to receive the whole frame. Raw payloads
+/// are skipped without being looked at.
+///
+/// The sizes are controlled by the peer, so a frame is rejected as soon as it is known to exceed
+/// the limit, before anything is allocated for it.
+///
+/// \internal
+class frame_scanner_t {
+public:
+    enum : size_t {
+        /// Maximum nesting depth of containers, the same as the MessagePack unpacker one.
+        max_depth = 32
+    };
+
+private:
+    /// Maximum frame size.
+    const size_t limit;
+    /// Offset of the next element header relative to the frame start.
+    size_t offset;
+    /// Number of bytes required to make progress.
+    size_t needed_;
+    /// Number of elements left to scan on each nesting level.
+    std::vector<std::uint64_t> stack;
+
+public:
+    explicit
+    frame_scanner_t(size_t limit);
+
+    /// Continues scanning the frame, which starts at the given data pointer.
+    ///
+    /// Sets the frame format error if the frame exceeds the limit or nests containers deeper than
+    /// the maximum depth.
+    ///
+    /// \returns the frame size if it has been completely received, zero otherwise.
+    size_t scan(const char* data, size_t size, std::error_code& ec);
+
+    /// Returns the number of bytes the frame still needs before the scanner can make progress.
+    size_t needed() const noexcept {
+        return needed_;
+    }
+
+private:
+    void reset();
+};
+
 /// The decoder represents streaming MessagePack decoding.
 ///
-/// \note this class does explicit memory copying to the message_type object.
 /// \internal
 struct decoder_t {
     typedef decoded_message message_type;
+
+    /// Largest frame accepted from the peer, a larger one fails the stream with the frame format
+    /// error.
+    static const size_t max_frame_size = 1 << 26;
+
     hpack::header_table_t header_table;
 
+    /// Zones for in place decoded messages, they are returned here when the message is destroyed.
+    const std::shared_ptr<zone_pool_t> zones;
+
+    decoder_t();
+
+    /// Decodes a message from the given memory region.
+    ///
+    /// \note this overload does explicit memory copying to the message_type object.
     size_t decode(const char* data, size_t size, message_type& message, std::error_code& ec);
+
+    /// Decodes a message in place from the given region of the read buffer.
+    ///
+    /// No memory copying is performed, instead the message pins the buffer until destroyed. The
+    /// message zone is drawn from the zone pool.
+    ///
+    /// The frame boundary is tracked incrementally, so a partially received frame is not parsed
+    /// again from its start on each call. Hence the region must always start at the frame start.
+    ///
+    /// Only the frame envelope and headers are unpacked, the arguments are left encoded.
+    size_t decode(const std::shared_ptr<buffer_t>& buffer, size_t offset, size_t size, message_type& message, std::error_code& ec);
+
+    /// Returns the number of bytes the current frame still needs, if known.
+    ///
+    /// The frame is never allowed to grow beyond the maximum frame size, so neither is this.
+    size_t needed() const noexcept {
+        return scanner.needed();
+    }
+
+private:
+    frame_scanner_t scanner;
+    /// Finds the boundary of message arguments within a complete frame.
+    frame_scanner_t arguments;
+
+    /// Checks the frame envelope, unpacking its headers if any.
+    bool validate(const msgpack::object& object, std::vector<hpack::header_t>& headers);
+
+    /// Unpacks the frame headers, updating the header table.
+    bool unpack_headers(const msgpack::object& meta, std::vector<hpack::header_t>& headers);
 };
 
 } // namespace detail
@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <asio/generic/stream_protocol.hpp>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Keeps exponentially weighted moving averages of the round-trip time and the error rate of each
+/// endpoint a session has connected to.
+///
+/// The round-trip time is sampled from the connection handshake, errors are counted both for failed
+/// connects and for established connections broken by network errors. The error rate also decays
+/// with time, so an endpoint which has failed becomes eligible again after a while even if no other
+/// endpoint fails.
+///
+/// \internal
+/// \threadsafe
+class endpoint_stats_t {
+public:
+    typedef asio::generic::stream_protocol::endpoint endpoint_type;
+    typedef std::chrono::steady_clock clock_type;
+
+    struct stats_t {
+        /// Average round-trip time in microseconds, zero if never connected.
+        double rtt;
+        /// Average error rate in [0; 1].
+        double errors;
+    };
+
+private:
+    /// Weights of the latest sample.
+    static constexpr double rtt_alpha = 0.3;
+    static constexpr double errors_alpha = 0.5;
+
+    /// Endpoints with the error rate above this are tried only after all the healthy ones.
+    static constexpr double healthy_threshold = 0.25;
+
+    /// Period, during which the error rate halves on its own.
+    static constexpr double errors_half_life = 10.0;
+
+    struct entry_t {
+        double rtt;
+        double errors;
+        clock_type::time_point updated;
+    };
+
+    mutable std::mutex mutex;
+    std::map<endpoint_type, entry_t> entries;
+
+public:
+    /// Returns the statistics of the given endpoint, zeros if it is unknown.
+    stats_t
+    get(const endpoint_type& endpoint) const {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = entries.find(endpoint);
+        if (it == entries.end()) {
+            return stats_t{ 0.0, 0.0 };
+        }
+
+        return stats_t{ it->second.rtt, decayed(it->second, clock_type::now()) };
+    }
+
+    /// Returns the given endpoints in the order they should be tried.
+    ///
+    /// Healthy endpoints go first, from the fastest to the slowest. Endpoints, which round-trip
+    /// time is unknown because they have never been connected to, are ranked with the mean one of
+    /// the given endpoints, so they are probed without going ahead of the proven fast ones. The
+    /// original order is preserved among equal endpoints.
+    ///
+    /// The given endpoints are the ones currently resolved, so the statistics of the others are
+    /// dropped.
+    std::vector<endpoint_type>
+    order(std::vector<endpoint_type> endpoints) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!endpoints.empty()) {
+            prune(endpoints);
+        }
+
+        const auto now = clock_type::now();
+
+        double total = 0.0;
+        std::size_t known = 0;
+        for (const auto& endpoint : endpoints) {
+            auto it = entries.find(endpoint);
+            if (it != entries.end() && it->second.rtt > 0.0) {
+                total += it->second.rtt;
+                ++known;
+            }
+        }
+
+        const double mean = known > 0 ? total / known : 0.0;
+
+        std::vector<std::pair<bool, double>> keys;
+        for (const auto& endpoint : endpoints) {
+            auto it = entries.find(endpoint);
+            if (it == entries.end()) {
+                keys.emplace_back(false, mean);
+            } else {
+                const double rtt = it->second.rtt > 0.0 ? it->second.rtt : mean;
+                keys.emplace_back(decayed(it->second, now) > healthy_threshold, rtt);
+            }
+        }
+
+        std::vector<std::size_t> ids(endpoints.size());
+        for (std::size_t id = 0; id < ids.size(); ++id) {
+            ids[id] = id;
+        }
+
+        std::stable_sort(ids.begin(), ids.end(), [&](std::size_t lhs, std::size_t rhs) {
+            return keys[lhs] < keys[rhs];
+        });
+
+        std::vector<endpoint_type> result;
+        result.reserve(endpoints.size());
+        for (auto id : ids) {
+            result.push_back(std::move(endpoints[id]));
+        }
+
+        return result;
+    }
+
+    /// Records a successful connect, which took the given time.
+    void
+    success(const endpoint_type& endpoint, clock_type::duration elapsed) {
+        const double rtt = std::chrono::duration<double, std::micro>(elapsed).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto now = clock_type::now();
+        auto it = entries.find(endpoint);
+        if (it == entries.end()) {
+            entries.insert(std::make_pair(endpoint, entry_t{ rtt, 0.0, now }));
+            return;
+        }
+
+        auto& entry = it->second;
+        entry.rtt = entry.rtt == 0.0 ? rtt : rtt_alpha * rtt + (1 - rtt_alpha) * entry.rtt;
+        entry.errors = (1 - errors_alpha) * decayed(entry, now);
+        entry.updated = now;
+    }
+
+    /// Records either a failed connect or a broken connection.
+    void
+    failure(const endpoint_type& endpoint) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto now = clock_type::now();
+        auto& entry = entries.insert(std::make_pair(endpoint, entry_t{ 0.0, 0.0, now })).first->second;
+        entry.errors = errors_alpha + (1 - errors_alpha) * decayed(entry, now);
+        entry.updated = now;
+    }
+
+private:
+    /// Drops the statistics of the endpoints, which are not among the given ones.
+    void
+    prune(const std::vector<endpoint_type>& endpoints) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (std::find(endpoints.begin(), endpoints.end(), it->first) == endpoints.end()) {
+                it = entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    static
+    double
+    decayed(const entry_t& entry, clock_type::time_point now) {
+        const double elapsed = std::chrono::duration<double>(now - entry.updated).count();
+        return entry.errors * std::exp2(-elapsed / errors_half_life);
+    }
+};
+
+}}} // namespace cocaine::framework::detail
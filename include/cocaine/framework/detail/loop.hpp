@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <memory>
+
 #include "cocaine/framework/detail/forwards.hpp"
+#include "cocaine/framework/detail/timer_wheel.hpp"
 
 namespace cocaine {
 
@@ -29,14 +32,19 @@ struct event_loop_t {
     loop_type& loop;
     loop_type& userloop;
 
-    explicit event_loop_t(loop_type& loop) noexcept :
+    /// Deadlines of the IO loop operations.
+    const std::shared_ptr<detail::timer_wheel_t> wheel;
+
+    explicit event_loop_t(loop_type& loop) :
         loop(loop),
-        userloop(loop)
+        userloop(loop),
+        wheel(std::make_shared<detail::timer_wheel_t>(loop))
     {}
 
-    event_loop_t(loop_type& ioloop, loop_type& userloop) noexcept :
+    event_loop_t(loop_type& ioloop, loop_type& userloop) :
         loop(ioloop),
-        userloop(userloop)
+        userloop(userloop),
+        wheel(std::make_shared<detail::timer_wheel_t>(ioloop))
     {}
 };
 
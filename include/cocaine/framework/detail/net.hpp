@@ -16,13 +16,19 @@
 
 #pragma once
 
+#include <system_error>
 #include <vector>
 
 #include <boost/asio/ip/address.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 
+#include <asio/generic/stream_protocol.hpp>
 #include <asio/ip/address.hpp>
 #include <asio/ip/tcp.hpp>
+#include <asio/local/stream_protocol.hpp>
+
+#include "cocaine/framework/socket_options.hpp"
 
 namespace cocaine { namespace framework { namespace detail {
 
@@ -31,6 +37,15 @@ asio::ip::address address_cast(const boost::asio::ip::address& address);
 
 boost::asio::ip::tcp::endpoint endpoint_cast(const asio::ip::tcp::endpoint& endpoint);
 asio::ip::tcp::endpoint endpoint_cast(const boost::asio::ip::tcp::endpoint& endpoint);
+asio::local::stream_protocol::endpoint endpoint_cast(const boost::asio::local::stream_protocol::endpoint& endpoint);
+
+/// Returns true if the given endpoint is either an IPv4 or an IPv6 one.
+bool
+is_tcp(const asio::generic::stream_protocol::endpoint& endpoint);
+
+/// \pre is_tcp(endpoint).
+asio::ip::tcp::endpoint
+tcp_cast(const asio::generic::stream_protocol::endpoint& endpoint);
 
 template<class To, class From>
 std::vector<To> endpoints_cast(const std::vector<From>& from) {
@@ -42,4 +57,17 @@ std::vector<To> endpoints_cast(const std::vector<From>& from) {
     return result;
 }
 
+/// Applies the given options to the socket with the given native handle.
+///
+/// Options the platform does not support are skipped, TCP ones are skipped unless `tcp` is set.
+/// The remaining options are applied even if some of them fail.
+///
+/// \returns the first error occurred, if any.
+std::error_code
+apply(int fd, const socket_options_t& options, bool tcp);
+
+/// Sets TCP_QUICKACK again, because the kernel may reset it while the connection lives.
+void
+quickack(int fd);
+
 }}} // namespace cocaine::framework::detail
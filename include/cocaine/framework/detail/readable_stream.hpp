@@ -0,0 +1,430 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <boost/none.hpp>
+
+#include <asio/buffer.hpp>
+#include <asio/error.hpp>
+
+#include <cocaine/errors.hpp>
+
+#include "cocaine/framework/message.hpp"
+
+#include "cocaine/framework/detail/buffer.hpp"
+#include "cocaine/framework/detail/decoder.hpp"
+#include "cocaine/framework/detail/timer_wheel.hpp"
+#include "cocaine/framework/detail/zone.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Reads and decodes protocol messages from the socket without copying them.
+///
+/// Unlike the Cocaine readable stream the data is received into reference-counted buffers, which
+/// are pinned by decoded messages, so frames are unpacked in place. A partially received frame
+/// tail is the only thing that is copied, once, when the current buffer is exhausted.
+///
+/// When nothing is pending the stream first reads speculatively into its buffer. Only if the socket
+/// is empty it waits for the socket to become readable, holding no read operation on the buffer.
+/// After the stream has waited for a while, the buffer is retired to the process-wide pool, so idle
+/// connections hold no read memory. The buffer acquired for the next read is sized after the moving
+/// average of the previous reads: it grows while reads fill it entirely and shrinks back when the
+/// traffic calms down.
+///
+/// \internal
+template<class Protocol>
+class readable_stream_t:
+    public std::enable_shared_from_this<readable_stream_t<Protocol>>
+{
+public:
+    typedef Protocol protocol_type;
+    typedef typename protocol_type::socket socket_type;
+    typedef decoder_t::message_type message_type;
+
+private:
+    enum : std::size_t {
+        /// Initial read buffer size.
+        initial_size = 65536,
+        /// Bounds of the read buffer size chosen after the traffic. Larger frames still get buffers
+        /// they fit in.
+        min_size = 8192,
+        max_size = 1 << 22,
+        /// Minimum free space required to issue the next read.
+        min_read_size = 4096,
+        /// A buffer with nothing pending is replaced when it is this times larger than the target.
+        max_oversize = 4,
+        /// Period in milliseconds the stream must wait with nothing pending to retire its buffer.
+        idle_timeout = 1000
+    };
+
+    /// Weight of the latest read in the moving average.
+    static constexpr double alpha = 0.25;
+
+    const std::shared_ptr<socket_type> socket;
+
+    decoder_t decoder;
+    buffer_pool_t& pool;
+    /// The read buffer, null after it has been retired while idle.
+    std::shared_ptr<buffer_t> buffer;
+
+    const std::shared_ptr<timer_wheel_t> wheel;
+    /// Checks periodically whether the stream is idle while it holds a buffer.
+    std::shared_ptr<deadline_t> idle;
+    /// Number of completed reads, which tells the idle check whether the stream has been active.
+    std::uint64_t reads;
+    /// Number of reads, which returned data.
+    std::uint64_t received_;
+    /// Whether the stream waits for the socket to become readable with nothing pending.
+    bool waiting;
+
+    /// Moving average of the number of bytes received by a read.
+    double average;
+
+    /// Number of bytes received into the current buffer.
+    std::size_t rd_offset;
+    /// Number of bytes already decoded from the current buffer.
+    std::size_t rx_offset;
+
+public:
+    readable_stream_t(std::shared_ptr<socket_type> socket, std::shared_ptr<timer_wheel_t> wheel) :
+        socket(std::move(socket)),
+        pool(buffer_pool_t::instance()),
+        wheel(std::move(wheel)),
+        reads(0),
+        received_(0),
+        waiting(false),
+        average(static_cast<double>(initial_size / 2)),
+        rd_offset(0),
+        rx_offset(0)
+    {
+        // Data is read synchronously, either speculatively or once the socket is known to be
+        // readable, which must never block the loop.
+        std::error_code ec;
+        this->socket->non_blocking(true, ec);
+    }
+
+    ~readable_stream_t() {
+        if (buffer) {
+            pool.release(std::move(buffer));
+        }
+    }
+
+    /// Decodes the next message, reading more data from the socket if required.
+    ///
+    /// The handler is always invoked asynchronously.
+    template<class Handler>
+    void
+    read(message_type& message, Handler handler) {
+        std::error_code ec = cocaine::error::insufficient_bytes;
+        std::size_t decoded = 0;
+
+        if (rd_offset != rx_offset) {
+            ec.clear();
+            decoded = decoder.decode(buffer, rx_offset, rd_offset - rx_offset, message, ec);
+        }
+
+        if (ec == cocaine::error::insufficient_bytes) {
+            receive(std::bind(&readable_stream_t::template fill<Handler>, this->shared_from_this(),
+                std::ref(message), std::move(handler), std::placeholders::_1, std::placeholders::_2));
+            return;
+        }
+
+        rx_offset += decoded;
+        socket->get_io_service().post(std::bind(std::move(handler), ec));
+    }
+
+    /// Decodes all complete messages available in the buffer at once, appending them to the given
+    /// batch, reading more data from the socket if there is none.
+    ///
+    /// The handler is always invoked asynchronously with a non-empty batch unless an error occurs.
+    /// On a decoding error the batch holds the messages decoded before the malformed frame.
+    template<class Handler>
+    void
+    read(std::vector<message_type>& batch, Handler handler) {
+        std::error_code ec;
+
+        while (rd_offset != rx_offset) {
+            batch.emplace_back(boost::none);
+            const auto decoded = decoder.decode(buffer, rx_offset, rd_offset - rx_offset, batch.back(), ec);
+
+            if (ec == cocaine::error::insufficient_bytes) {
+                batch.pop_back();
+                ec.clear();
+                break;
+            }
+
+            rx_offset += decoded;
+
+            if (ec) {
+                // Only the messages decoded before the malformed frame are returned.
+                batch.pop_back();
+                break;
+            }
+        }
+
+        if (batch.empty() && !ec) {
+            receive(std::bind(&readable_stream_t::template fill_batch<Handler>, this->shared_from_this(),
+                std::ref(batch), std::move(handler), std::placeholders::_1, std::placeholders::_2));
+            return;
+        }
+
+        socket->get_io_service().post(std::bind(std::move(handler), ec));
+    }
+
+    /// Returns the number of socket reads, which returned data.
+    std::uint64_t
+    received() const noexcept {
+        return received_;
+    }
+
+    /// Returns the message zone pool statistics.
+    ///
+    /// \threadsafe
+    zone_pool_t::stats_t
+    zone_stats() const noexcept {
+        return decoder.zones->stats();
+    }
+
+private:
+    /// Receives more data into the read buffer, invoking the callback with the number of bytes
+    /// received.
+    ///
+    /// If nothing is pending, the data is read speculatively, and only if there is none the stream
+    /// waits for the socket to become readable, so the buffer can be retired meanwhile.
+    template<class Callback>
+    void
+    receive(Callback callback) {
+        prepare();
+
+        if (rd_offset == rx_offset) {
+            std::error_code ec;
+            const auto bytes = socket->read_some(
+                asio::buffer(buffer->data() + rd_offset, buffer->size() - rd_offset), ec
+            );
+
+            // The callback is usually a bind expression itself, which must not be nested into
+            // another one, hence the lambdas.
+            auto self = this->shared_from_this();
+
+            if (!ec) {
+                on_read(std::move(callback), ec, bytes);
+                return;
+            }
+
+            if (ec != asio::error::would_block && ec != asio::error::try_again) {
+                // Errors are reported asynchronously, because the reader may hold locks its error
+                // handling takes.
+                socket->get_io_service().post([self, callback, ec]() mutable {
+                    self->on_read(std::move(callback), ec, 0);
+                });
+                return;
+            }
+
+            waiting = true;
+            watch();
+
+            socket->async_read_some(asio::null_buffers(),
+                [self, callback](const std::error_code& ec, std::size_t) mutable {
+                    self->on_readable(std::move(callback), ec);
+                }
+            );
+            return;
+        }
+
+        auto self = this->shared_from_this();
+        socket->async_read_some(
+            asio::buffer(buffer->data() + rd_offset, buffer->size() - rd_offset),
+            [self, callback](const std::error_code& ec, std::size_t bytes) mutable {
+                self->on_read(std::move(callback), ec, bytes);
+            }
+        );
+    }
+
+    template<class Callback>
+    void
+    on_readable(Callback callback, const std::error_code& ec) {
+        waiting = false;
+
+        if (ec) {
+            callback(ec, 0);
+            return;
+        }
+
+        // Spurious wakeups end up waiting again.
+        receive(std::move(callback));
+    }
+
+    /// Schedules the idle check unless it is pending already.
+    ///
+    /// A single check per period is scheduled however many reads complete meanwhile, so busy
+    /// streams barely touch the timer wheel.
+    void
+    watch() {
+        if (!wheel || idle || !buffer) {
+            return;
+        }
+
+        std::weak_ptr<readable_stream_t> weak(this->shared_from_this());
+        const auto mark = reads;
+
+        idle = wheel->schedule(std::chrono::milliseconds(idle_timeout), [weak, mark] {
+            if (auto self = weak.lock()) {
+                // The stream state belongs to the socket loop.
+                self->socket->get_io_service().dispatch([self, mark] {
+                    self->on_idle(mark);
+                });
+            }
+        });
+    }
+
+    /// Retires the buffer if the stream still waits with no reads completed since the check has
+    /// been scheduled, otherwise checks again later.
+    void
+    on_idle(std::uint64_t mark) {
+        idle.reset();
+
+        if (waiting && reads == mark && buffer) {
+            pool.release(std::move(buffer));
+            rd_offset = rx_offset = 0;
+            return;
+        }
+
+        watch();
+    }
+
+    template<class Callback>
+    void
+    on_read(Callback callback, const std::error_code& ec, std::size_t bytes) {
+        ++reads;
+
+        if (!ec) {
+            if (bytes > 0) {
+                ++received_;
+            }
+
+            average = alpha * static_cast<double>(bytes) + (1 - alpha) * average;
+
+            // A read filling the whole buffer means the socket has more data, so the next buffer
+            // should be at least twice as large.
+            if (bytes == buffer->size() - rd_offset) {
+                average = std::max(average, static_cast<double>(bytes));
+            }
+        }
+
+        callback(ec, bytes);
+    }
+
+    template<class Handler>
+    void
+    fill(message_type& message, Handler handler, const std::error_code& ec, std::size_t bytes) {
+        if (ec) {
+            handler(ec);
+            return;
+        }
+
+        rd_offset += bytes;
+        read(message, std::move(handler));
+    }
+
+    template<class Handler>
+    void
+    fill_batch(std::vector<message_type>& batch, Handler handler, const std::error_code& ec, std::size_t bytes) {
+        if (ec) {
+            handler(ec);
+            return;
+        }
+
+        rd_offset += bytes;
+        read(batch, std::move(handler));
+    }
+
+    /// Returns the buffer size suited for the observed reads, which is the power of two at least
+    /// twice as large as the average read.
+    std::size_t
+    target() const noexcept {
+        std::size_t size = min_size;
+        while (size < max_size && static_cast<double>(size) < 2 * average) {
+            size *= 2;
+        }
+
+        return size;
+    }
+
+    /// Makes room for the next read.
+    ///
+    /// A retired buffer is replaced with the one of the target size, as is a buffer with nothing
+    /// pending which is much larger than the target, once the traffic has calmed down. The pending
+    /// bytes of a
+    /// partially received frame are either moved to the front of the current buffer, if no message
+    /// pins it, or copied into a new one, which is larger if the frame does not fit. When the
+    /// decoder already knows how many bytes the frame lacks, the buffer is grown to fit it at once.
+    void
+    prepare() {
+        const std::size_t pending = rd_offset - rx_offset;
+        // The peer controls the frame size, which the decoder bounds by failing larger frames.
+        const std::size_t required = std::max<std::size_t>(min_read_size, decoder.needed());
+
+        if (!buffer || (pending == 0 && buffer->size() > max_oversize * std::max(target(), required))) {
+            if (buffer) {
+                pool.release(std::move(buffer));
+            }
+
+            buffer = pool.acquire(std::max(target(), required));
+            rd_offset = rx_offset = 0;
+            return;
+        }
+
+        if (pending == 0 && buffer.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            rd_offset = rx_offset = 0;
+        }
+
+        if (buffer->size() - rd_offset >= required) {
+            return;
+        }
+
+        std::size_t size = buffer->size();
+        if (size < pending + required) {
+            size = std::max({ 2 * size, pending + required, target() });
+        }
+
+        if (size == buffer->size() && buffer.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::memmove(buffer->data(), buffer->data() + rx_offset, pending);
+        } else {
+            auto next = pool.acquire(size);
+            std::memcpy(next->data(), buffer->data() + rx_offset, pending);
+            pool.release(std::move(buffer));
+            buffer = std::move(next);
+        }
+
+        rd_offset = pending;
+        rx_offset = 0;
+    }
+};
+
+}}} // namespace cocaine::framework::detail
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <queue>
 
 #include "cocaine/framework/forwards.hpp"
@@ -40,16 +41,34 @@ private:
 
     boost::optional<std::error_code> broken;
 
+    /// Number of get calls made and number of messages they have received.
+    std::uint64_t requested;
+    std::uint64_t consumed;
+
     std::mutex mutex;
 
 public:
     shared_state_t() :
+        requested(0),
+        consumed(0),
         trace(trace_t::current())
     {}
+
+    /// Delivers the message, which is dropped if the state is already broken, for example by an
+    /// expired deadline.
     void put(value_type&& message);
     void put(const std::error_code& ec);
     auto get() -> task<value_type>::future_type;
 
+    /// Same as get, additionally returning the ticket of the requested message, see expire.
+    auto get(std::uint64_t& ticket) -> task<value_type>::future_type;
+
+    /// Breaks the state with the given error unless the message with the given ticket has already
+    /// been received.
+    ///
+    /// \returns true if the state has been broken by this call.
+    bool expire(const std::error_code& ec, std::uint64_t ticket);
+
     trace_t trace;
 };
 
@@ -0,0 +1,187 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include <asio/deadline_timer.hpp>
+
+#include "cocaine/framework/detail/forwards.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+class timer_wheel_t;
+
+/// Handle of a callback scheduled on the timer wheel, which cancels it on destruction.
+///
+/// \internal
+/// \threadsafe
+class deadline_t {
+    friend class timer_wheel_t;
+
+public:
+    typedef std::function<void()> callback_type;
+
+private:
+    const std::weak_ptr<timer_wheel_t> wheel;
+
+    /// The callback, empty after the deadline has either fired or been cancelled, protected by the
+    /// wheel lock.
+    callback_type callback;
+
+public:
+    deadline_t(std::weak_ptr<timer_wheel_t> wheel, callback_type callback);
+
+    deadline_t(const deadline_t&) = delete;
+    deadline_t& operator=(const deadline_t&) = delete;
+
+    ~deadline_t();
+
+    /// Cancels the deadline unless it has fired already.
+    void
+    cancel();
+};
+
+/// Hierarchical timer wheel, which fires scheduled callbacks on the event loop.
+///
+/// Scheduling and cancelling a deadline takes constant time and a deadline takes a few dozen bytes,
+/// so a loop can keep millions of them, unlike asio timers, each of which is a separate entry in
+/// the loop timer queue. The price is the resolution of one tick, a millisecond.
+///
+/// The nearest level has a slot per tick, each outer level has a slot per the whole span of the
+/// previous one. Deadlines are placed into the level which span covers their timeout and cascade
+/// into nearer levels as the time passes. Deadlines beyond the outermost level are kept in its
+/// farthest slot until they come within its span.
+///
+/// The wheel refers to deadlines weakly, so the owner of a deadline controls its lifetime and a
+/// cancelled deadline takes only a slot entry until the wheel passes it.
+///
+/// The wheel is driven by a single loop timer, which is armed only while there are pending
+/// deadlines, so an idle wheel neither wakes the loop nor keeps it running.
+///
+/// \internal
+/// \threadsafe
+class timer_wheel_t:
+    public std::enable_shared_from_this<timer_wheel_t>
+{
+    friend class deadline_t;
+
+public:
+    typedef std::chrono::steady_clock clock_type;
+    typedef clock_type::time_point (*source_type)();
+    typedef deadline_t::callback_type callback_type;
+
+private:
+    enum : std::size_t {
+        /// Number of bits of a tick, which select the slot of the nearest level.
+        near_bits = 8,
+        /// Number of bits of a tick, which select the slot of each outer level.
+        far_bits = 6,
+        /// Number of outer levels.
+        far_levels = 3
+    };
+
+    struct entry_t {
+        /// Expiration tick.
+        std::uint64_t expires;
+        std::weak_ptr<deadline_t> deadline;
+    };
+
+    typedef std::vector<entry_t> slot_type;
+
+    mutable std::mutex mutex;
+
+    /// Returns the current time.
+    const source_type source;
+    /// Wheel origin, ticks are counted from it.
+    const clock_type::time_point origin;
+    /// The last processed tick.
+    std::uint64_t tick;
+    /// Number of pending deadlines.
+    std::size_t size;
+    /// The tick the loop timer is armed for, zero if it is not armed.
+    std::uint64_t wakeup;
+
+    std::array<slot_type, 1 << near_bits> near;
+    std::array<std::array<slot_type, 1 << far_bits>, far_levels> far;
+
+    asio::deadline_timer timer;
+
+public:
+    /// \param source the time source, which is the steady clock unless the wheel is tested.
+    explicit
+    timer_wheel_t(loop_t& loop, source_type source = &clock_type::now);
+
+    /// Schedules the callback to be invoked on the event loop after the given timeout.
+    ///
+    /// The callback is invoked not earlier than the timeout passes, unless the returned deadline is
+    /// cancelled or destroyed before.
+    std::shared_ptr<deadline_t>
+    schedule(std::chrono::milliseconds timeout, callback_type callback);
+
+    /// Returns the number of pending deadlines.
+    std::size_t
+    pending() const;
+
+private:
+    /// Returns the current tick.
+    std::uint64_t
+    now() const;
+
+    /// \pre the mutex is locked.
+    void
+    place(entry_t&& entry);
+
+    /// Cancels the deadline unless it has fired already.
+    void
+    cancel(deadline_t& deadline);
+
+    /// Processes the ticks passed since the last one, collecting the expired deadlines with their
+    /// callbacks.
+    ///
+    /// The deadlines are returned to be released after the mutex is unlocked, because releasing the
+    /// last reference cancels the deadline, which locks the mutex.
+    ///
+    /// \pre the mutex is locked.
+    void
+    advance(std::vector<std::pair<std::shared_ptr<deadline_t>, callback_type>>& expired);
+
+    /// Moves deadlines of the current slot of the given outer level into nearer levels.
+    ///
+    /// \pre the mutex is locked.
+    void
+    cascade(std::size_t level);
+
+    /// Arms the loop timer for the next tick, which can have expired deadlines.
+    ///
+    /// \pre the mutex is locked.
+    void
+    rearm();
+
+    static
+    void
+    on_timer(std::weak_ptr<timer_wheel_t> wheel, const std::error_code& ec);
+};
+
+}}} // namespace cocaine::framework::detail
@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <system_error>
+
+#include "cocaine/framework/detail/readable_stream.hpp"
+#include "cocaine/framework/detail/writable_stream.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Socket with attached reader and writer streams.
+///
+/// Mirrors the Cocaine transport, but reads through the zero-copy framework reader and writes
+/// through the gathering framework writer.
+///
+/// \internal
+template<class Protocol>
+class transport_t {
+public:
+    typedef Protocol protocol_type;
+    typedef typename protocol_type::socket socket_type;
+
+    typedef readable_stream_t<protocol_type> reader_type;
+    typedef writable_stream_t<protocol_type> writer_type;
+
+    const std::shared_ptr<socket_type> socket;
+    const std::shared_ptr<reader_type> reader;
+    const std::shared_ptr<writer_type> writer;
+
+public:
+    /// \param wheel the timer wheel of the socket loop, which retires the read buffer while idle.
+    transport_t(std::unique_ptr<socket_type> socket_, std::shared_ptr<timer_wheel_t> wheel) :
+        socket(std::move(socket_)),
+        reader(std::make_shared<reader_type>(socket, std::move(wheel))),
+        writer(std::make_shared<writer_type>(socket))
+    {}
+
+    ~transport_t() {
+        std::error_code ec;
+        socket->shutdown(socket_type::shutdown_both, ec);
+        socket->close(ec);
+    }
+};
+
+}}} // namespace cocaine::framework::detail
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <map>
@@ -27,13 +28,14 @@
 #include <cocaine/forwards.hpp>
 #include <cocaine/idl/rpc.hpp>
 #include <cocaine/locked_ptr.hpp>
-#include <cocaine/rpc/asio/transport.hpp>
 
 #include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/message.hpp"
+#include "cocaine/framework/socket_options.hpp"
 #include "cocaine/framework/worker/dispatch.hpp"
 
 #include "cocaine/framework/detail/decoder.hpp"
+#include "cocaine/framework/detail/transport.hpp"
 
 namespace cocaine {
 
@@ -64,7 +66,7 @@ private:
     detail::decoder_t::message_type message;
 
     /// Underlying transport.
-    typedef io::transport<protocol_type, io::encoder_t, detail::decoder_t> transport_type;
+    typedef detail::transport_t<protocol_type> transport_type;
     synchronized<std::unique_ptr<transport_type>> transport;
 
     std::atomic<std::uint64_t> counter;
@@ -77,9 +79,12 @@ private:
 public:
     worker_session_t(dispatch_t& dispatch, scheduler_t& scheduler, executor_t executor);
 
-    /// Performs synchronous connection to the given endpoint.
+    /// Performs synchronous connection to the given endpoint, applying the given socket options
+    /// beforehand.
+    ///
+    /// TCP options are ignored, because the runtime is connected via a local socket.
     void
-    connect(const endpoint_type& endpoint);
+    connect(const endpoint_type& endpoint, const socket_options_t& options = socket_options_t());
 
     /// Runs the session event processing by sending a handshake message with the given uuid and
     /// starting to listen incoming messages.
@@ -91,12 +96,25 @@ public:
     void
     run(const std::string& uuid);
 
+    /// Sets the outbound queue watermarks, see basic_session_t::watermarks.
+    ///
+    /// \pre !!transport.
+    void
+    watermarks(std::size_t high, std::size_t low);
+
     future<void>
     push(io::encoder_t::message_type&& message);
 
+    future<void>
+    push(frame_t&& frame);
+
     void
     revoke(std::uint64_t span);
 
+    /// Schedules the callback on the event loop timer wheel.
+    std::shared_ptr<detail::deadline_t>
+    schedule(std::chrono::milliseconds timeout, std::function<void()> callback);
+
 private:
     /// Handle incoming protocol message.
     void on_read(const std::error_code& ec);
@@ -0,0 +1,356 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include <asio/buffer.hpp>
+#include <asio/deadline_timer.hpp>
+#include <asio/write.hpp>
+
+#include <msgpack.hpp>
+
+#include <cocaine/hpack/header.hpp>
+#include <cocaine/hpack/msgpack_traits.hpp>
+
+#include "cocaine/framework/encoder.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Writes encoded protocol messages to the socket, gathering all messages queued while the
+/// previous write is in progress into a single scatter-gather write.
+///
+/// Writes are always issued from the event loop thread. A message queued to an idle stream is
+/// written on the next loop iteration, so messages queued in a burst share a write as well. The
+/// stream can also be corked: the write is then delayed until either the given number of bytes is
+/// queued or the given latency passes.
+///
+/// Frame headers are encoded when the frame is queued, using the connection header table, so
+/// repeated headers are sent as table references. Queueing under the lock keeps the table updates in
+/// the order the peer decodes them.
+///
+/// Each message handler is invoked after the write containing the message completes. If the
+/// high watermark is set, the stream throttles when the number of queued bytes exceeds it: message
+/// handlers are then held back until the queue drains to the low watermark. Producers waiting for
+/// send completions are therefore slowed down to the socket speed instead of growing the queue.
+///
+/// \internal
+/// \threadsafe
+template<class Protocol>
+class writable_stream_t:
+    public std::enable_shared_from_this<writable_stream_t<Protocol>>
+{
+public:
+    typedef Protocol protocol_type;
+    typedef typename protocol_type::socket socket_type;
+    typedef std::function<void(const std::error_code&)> handler_type;
+
+private:
+    const std::shared_ptr<socket_type> socket;
+
+    std::mutex mutex;
+
+    /// Messages waiting for the next write.
+    std::vector<asio::const_buffer> pending;
+    std::vector<handler_type> pending_handlers;
+    std::size_t pending_bytes;
+
+    /// Messages being written, accessed only by the event loop thread.
+    std::vector<asio::const_buffer> inflight;
+    std::vector<handler_type> inflight_handlers;
+
+    /// Outgoing header compression state.
+    hpack::header_table_t header_table;
+    /// Encoded headers of pending and inflight messages.
+    std::vector<std::unique_ptr<msgpack::sbuffer>> pending_headers;
+    std::vector<std::unique_ptr<msgpack::sbuffer>> inflight_headers;
+
+    /// Number of queued bytes, including the ones being written.
+    std::size_t queued_bytes;
+    /// Number of bytes being written.
+    std::size_t inflight_bytes;
+
+    /// Whether a flush is scheduled or a write is in progress.
+    bool writing;
+    /// Whether the cork timer is armed.
+    bool armed;
+    /// The error the stream has failed with, if any.
+    std::error_code broken;
+
+    std::size_t cork_bytes;
+    boost::posix_time::time_duration cork_latency;
+    asio::deadline_timer timer;
+
+    std::size_t high_watermark;
+    std::size_t low_watermark;
+    /// Whether the queue has exceeded the high watermark and has not drained to the low one yet.
+    bool throttled;
+    /// Handlers waiting for the queue to drain.
+    std::vector<handler_type> drain_handlers;
+
+public:
+    explicit
+    writable_stream_t(std::shared_ptr<socket_type> socket) :
+        socket(std::move(socket)),
+        pending_bytes(0),
+        queued_bytes(0),
+        inflight_bytes(0),
+        writing(false),
+        armed(false),
+        cork_bytes(0),
+        cork_latency(boost::posix_time::microseconds(0)),
+        timer(this->socket->get_io_service()),
+        high_watermark(0),
+        low_watermark(0),
+        throttled(false)
+    {}
+
+    /// Sets the cork bounds.
+    ///
+    /// While the stream is idle queued messages are held until at least `bytes` bytes are queued
+    /// or `latency` passes since the first of them. Zero latency disables corking.
+    void
+    cork(std::size_t bytes, std::chrono::microseconds latency) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cork_bytes = bytes;
+        cork_latency = boost::posix_time::microseconds(latency.count());
+    }
+
+    /// Sets the queue watermarks.
+    ///
+    /// Zero high watermark, which is the default, disables throttling.
+    void
+    watermarks(std::size_t high, std::size_t low) {
+        std::vector<handler_type> handlers;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            high_watermark = high;
+            low_watermark = std::min(low, high);
+            handlers = drain();
+        }
+
+        for (auto& handler : handlers) {
+            socket->get_io_service().post(std::bind(std::move(handler), std::error_code()));
+        }
+    }
+
+    /// Returns the number of queued bytes, including the ones being written.
+    std::size_t
+    queued() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queued_bytes;
+    }
+
+    /// Invokes the given handler once the stream is not throttled.
+    ///
+    /// The handler is always invoked asynchronously, with an error if the stream is broken.
+    void
+    writable(handler_type handler) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (throttled && !broken) {
+            drain_handlers.push_back(std::move(handler));
+        } else {
+            socket->get_io_service().post(std::bind(std::move(handler), broken));
+        }
+    }
+
+    /// Queues the given frame for writing.
+    ///
+    /// \warning the frame must be kept alive until the handler is invoked.
+    void
+    write(const frame_t& frame, handler_type handler) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (broken) {
+            socket->get_io_service().post(std::bind(std::move(handler), broken));
+            return;
+        }
+
+        std::unique_ptr<msgpack::sbuffer> headers;
+        if (!frame.headers().empty()) {
+            headers.reset(new msgpack::sbuffer(256));
+            msgpack::packer<msgpack::sbuffer> packer(*headers);
+            hpack::msgpack_traits::pack_vector(packer, header_table, frame.headers());
+        }
+
+        const auto size = frame.size() + (headers ? headers->size() : 0);
+
+        frame.gather(pending);
+        if (headers) {
+            pending.emplace_back(headers->data(), headers->size());
+            pending_headers.push_back(std::move(headers));
+        }
+
+        pending_handlers.push_back(std::move(handler));
+        pending_bytes += size;
+        queued_bytes += size;
+
+        if (high_watermark > 0 && queued_bytes > high_watermark) {
+            throttled = true;
+        }
+
+        if (writing) {
+            return;
+        }
+
+        if (cork_latency.total_microseconds() == 0 || pending_bytes >= cork_bytes) {
+            writing = true;
+            socket->get_io_service().post(
+                std::bind(&writable_stream_t::flush, this->shared_from_this())
+            );
+        } else if (!armed) {
+            armed = true;
+            timer.expires_from_now(cork_latency);
+            timer.async_wait(
+                std::bind(&writable_stream_t::on_timer, this->shared_from_this())
+            );
+        }
+    }
+
+private:
+    void
+    on_timer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            armed = false;
+
+            if (writing || pending.empty()) {
+                return;
+            }
+
+            writing = true;
+        }
+
+        flush();
+    }
+
+    /// Writes all pending messages at once.
+    ///
+    /// \pre writing.
+    void
+    flush() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (pending.empty()) {
+                writing = false;
+                return;
+            }
+
+            std::swap(pending, inflight);
+            std::swap(pending_handlers, inflight_handlers);
+            std::swap(pending_headers, inflight_headers);
+            inflight_bytes = pending_bytes;
+            pending_bytes = 0;
+        }
+
+        asio::async_write(*socket, inflight,
+            std::bind(&writable_stream_t::on_write, this->shared_from_this(), std::placeholders::_1)
+        );
+    }
+
+    void
+    on_write(const std::error_code& ec) {
+        auto handlers = std::move(inflight_handlers);
+        inflight_handlers.clear();
+        inflight_headers.clear();
+        inflight.clear();
+
+        // Handlers of messages written earlier, which were held back while throttling.
+        std::vector<handler_type> drained;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued_bytes -= inflight_bytes;
+            inflight_bytes = 0;
+
+            if (ec) {
+                broken = ec;
+                writing = false;
+
+                // Fail the messages queued after the broken write as well.
+                for (auto& handler : pending_handlers) {
+                    handlers.push_back(std::move(handler));
+                }
+
+                pending.clear();
+                pending_handlers.clear();
+                pending_headers.clear();
+                pending_bytes = 0;
+                queued_bytes = 0;
+            }
+
+            drained = drain();
+
+            if (throttled) {
+                for (auto& handler : handlers) {
+                    drain_handlers.push_back(deferred(std::move(handler)));
+                }
+
+                handlers.clear();
+            }
+        }
+
+        for (auto& handler : drained) {
+            handler(ec);
+        }
+
+        for (auto& handler : handlers) {
+            handler(ec);
+        }
+
+        if (!ec) {
+            flush();
+        }
+    }
+
+    /// Stops throttling if the queue has drained to the low watermark or the stream is broken,
+    /// returning the handlers to invoke.
+    ///
+    /// \pre the mutex is locked.
+    std::vector<handler_type>
+    drain() {
+        std::vector<handler_type> handlers;
+
+        if (throttled && (broken || high_watermark == 0 || queued_bytes <= low_watermark)) {
+            throttled = false;
+            std::swap(handlers, drain_handlers);
+        }
+
+        return handlers;
+    }
+
+    /// Wraps the handler of a successfully written message, so it is held back while throttling
+    /// and does not observe errors occurred after its write.
+    static
+    handler_type
+    deferred(handler_type handler) {
+        return [handler](const std::error_code&) {
+            handler(std::error_code());
+        };
+    }
+};
+
+}}} // namespace cocaine::framework::detail
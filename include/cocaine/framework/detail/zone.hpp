@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <msgpack/zone.hpp>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Keeps cleared MessagePack zones for reuse by the decoder.
+///
+/// Zones are acquired in the IO thread while decoding and released by whatever thread destroys the
+/// decoded message, hence the locking. A cleared zone keeps its initial chunk, so reusing it saves
+/// the chunk allocation as well.
+///
+/// \internal
+/// \threadsafe
+class zone_pool_t {
+public:
+    struct stats_t {
+        /// Number of zones taken from the pool.
+        std::uint64_t hits;
+        /// Number of zones allocated, because the pool was empty.
+        std::uint64_t misses;
+    };
+
+private:
+    std::vector<std::unique_ptr<msgpack::zone>> zones;
+    const std::size_t capacity;
+    std::mutex mutex;
+
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+
+public:
+    /// Constructs a pool that keeps at most `capacity` released zones.
+    explicit
+    zone_pool_t(std::size_t capacity = 64) :
+        capacity(capacity),
+        hits(0),
+        misses(0)
+    {}
+
+    std::unique_ptr<msgpack::zone>
+    acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!zones.empty()) {
+                auto zone = std::move(zones.back());
+                zones.pop_back();
+                ++hits;
+                return zone;
+            }
+        }
+
+        ++misses;
+        return std::unique_ptr<msgpack::zone>(new msgpack::zone);
+    }
+
+    void
+    release(std::unique_ptr<msgpack::zone> zone) {
+        zone->clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (zones.size() < capacity) {
+            zones.push_back(std::move(zone));
+        }
+    }
+
+    stats_t
+    stats() const noexcept {
+        return stats_t{ hits.load(), misses.load() };
+    }
+};
+
+}}} // namespace cocaine::framework::detail
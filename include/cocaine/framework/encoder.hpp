@@ -20,17 +20,500 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/mpl/size.hpp>
+
+#include <asio/buffer.hpp>
+
+#include <msgpack.hpp>
+
+#include <cocaine/hpack/header.hpp>
 #include <cocaine/rpc/asio/encoder.hpp>
+#include <cocaine/traits/tuple.hpp>
 
 namespace cocaine { namespace framework {
 
-typedef std::function<io::encoder_t::message_type(std::uint64_t)> encode_callback_t;
+namespace detail {
+
+/// Packs an unsigned integer using the shortest MessagePack representation.
+///
+/// \returns the number of bytes written, at most 9.
+inline
+std::size_t
+pack_uint(char* out, std::uint64_t value) {
+    std::size_t width;
+    if (value <= 0x7f) {
+        out[0] = static_cast<char>(value);
+        return 1;
+    } else if (value <= 0xff) {
+        out[0] = static_cast<char>(0xcc);
+        width = 1;
+    } else if (value <= 0xffff) {
+        out[0] = static_cast<char>(0xcd);
+        width = 2;
+    } else if (value <= 0xffffffff) {
+        out[0] = static_cast<char>(0xce);
+        width = 4;
+    } else {
+        out[0] = static_cast<char>(0xcf);
+        width = 8;
+    }
+
+    for (std::size_t i = 0; i < width; ++i) {
+        out[width - i] = static_cast<char>(value >> (8 * i));
+    }
+
+    return 1 + width;
+}
+
+/// Returns the size of the MessagePack unsigned integer starting with the given byte, or zero if
+/// the byte does not start one.
+inline
+std::size_t
+uint_size(char type) {
+    const auto code = static_cast<unsigned char>(type);
+    if (code <= 0x7f) {
+        return 1;
+    } else if (code >= 0xcc && code <= 0xcf) {
+        return 1 + (std::size_t(1) << (code - 0xcc));
+    }
+
+    return 0;
+}
+
+/// Packs a raw (string) header for the given payload size.
+///
+/// Uses the raw16/raw32 formats, which both old and new MessagePack implementations understand.
+///
+/// \returns the number of bytes written, at most 5.
+inline
+std::size_t
+pack_raw_header(char* out, std::uint32_t size) {
+    if (size <= 31) {
+        out[0] = static_cast<char>(0xa0 | size);
+        return 1;
+    }
+
+    std::size_t width;
+    if (size <= 0xffff) {
+        out[0] = static_cast<char>(0xda);
+        width = 2;
+    } else {
+        out[0] = static_cast<char>(0xdb);
+        width = 4;
+    }
+
+    for (std::size_t i = 0; i < width; ++i) {
+        out[width - i] = static_cast<char>(size >> (8 * i));
+    }
+
+    return 1 + width;
+}
+
+/// MessagePack stream, which only counts the bytes written into it.
+///
+/// Packing into it is cheap, because raw data is never touched, which allows to compute the exact
+/// encoded message size before allocating a buffer for it.
+struct counting_stream_t {
+    std::size_t size;
+
+    void
+    write(const char*, std::size_t size) {
+        this->size += size;
+    }
+};
+
+/// MessagePack stream writing into a preallocated memory region without any bound checks.
+struct region_stream_t {
+    char* it;
+
+    void
+    write(const char* data, std::size_t size) {
+        std::memcpy(it, data, size);
+        it += size;
+    }
+};
+
+/// Keeps encoding buffers for reuse.
+///
+/// Buffers are acquired by the threads sending messages, but are usually released by the event
+/// loop thread, when the frame is destroyed after being written. That's why the pool is shared by
+/// all threads and locked instead of being thread-local, otherwise buffers would be migrating from
+/// the senders' pools to the event loop's one.
+///
+/// Like the read buffer pool, it keeps buffers in power of two size buckets, each with its own
+/// lock. The pool holds a reference to each kept buffer and hands out the ones nobody else refers
+/// to, so reusing a buffer allocates nothing, not even a reference counter.
+///
+/// \threadsafe
+class encode_pool_t {
+public:
+    typedef std::vector<char> buffer_type;
+
+private:
+    struct bucket_t {
+        std::mutex mutex;
+        std::size_t capacity;
+        std::vector<std::shared_ptr<buffer_type>> buffers;
+    };
+
+    enum : std::size_t {
+        /// Size class of the first bucket, as a power of two, which covers most control messages.
+        min_class = 9,
+        /// Size class of the last bucket, as a power of two. Larger buffers are not kept.
+        max_class = 20
+    };
+
+    std::array<bucket_t, max_class - min_class + 1> buckets;
+
+    encode_pool_t();
+
+public:
+    /// Returns the process-wide pool.
+    static
+    encode_pool_t&
+    instance();
+
+    /// Returns a buffer of at least the given size and less than twice as large, which becomes
+    /// available again after the last reference to it is dropped.
+    std::shared_ptr<buffer_type>
+    acquire(std::size_t size);
+};
+
+/// Packs the arguments of the given event.
+template<class Event, class Stream, class... Args>
+void
+pack_args(msgpack::packer<Stream>& packer, const Args&... args) {
+    io::type_traits<
+        typename io::event_traits<Event>::argument_type
+    >::pack(packer, args...);
+}
+
+} // namespace detail
+
+/// Immutable reference-counted memory region, which is written to the socket without copying.
+///
+/// The owner is kept alive until the region is written.
+class payload_t {
+    std::shared_ptr<const void> owner;
+    const char* data_;
+    std::size_t size_;
+
+public:
+    payload_t(std::shared_ptr<const void> owner, const char* data, std::size_t size) :
+        owner(std::move(owner)),
+        data_(data),
+        size_(size)
+    {}
+
+    /// Constructs a payload from the shared string or byte vector.
+    ///
+    /// \note this constructor is intentionally left implicit.
+    template<
+        class Container,
+        class = typename std::enable_if<
+            std::is_same<typename std::remove_const<Container>::type, std::string>::value ||
+            std::is_same<typename std::remove_const<Container>::type, std::vector<char>>::value
+        >::type
+    >
+    payload_t(std::shared_ptr<Container> container) :
+        data_(container->data()),
+        size_(container->size())
+    {
+        owner = std::move(container);
+    }
+
+    const char*
+    data() const noexcept {
+        return data_;
+    }
+
+    std::size_t
+    size() const noexcept {
+        return size_;
+    }
+};
+
+/// Encoded protocol message ready to be written.
+///
+/// Consists of a short head stored inline, an optional encoded body and payload regions, which are
+/// written in this order, all by reference.
+///
+/// Headers are attached unencoded, because they are compressed using the header table of the
+/// connection, and are encoded by the writer after the rest of the frame in the order frames are
+/// written.
+class frame_t {
+public:
+    enum : std::size_t {
+        /// Maximum size of the inline head.
+        head_capacity = 32
+    };
+
+private:
+    std::array<char, head_capacity> head;
+    std::size_t head_size;
+
+    std::shared_ptr<const void> owner;
+    asio::const_buffer body;
+
+    std::vector<payload_t> payload;
+
+    std::vector<hpack::header_t> headers_;
+
+public:
+    /// Constructs a frame from the encoded message.
+    explicit
+    frame_t(io::encoder_t::message_type message) :
+        head_size(0)
+    {
+        auto owned = std::make_shared<io::encoder_t::message_type>(std::move(message));
+        body = asio::const_buffer(owned->data(), owned->size());
+        owner = std::move(owned);
+    }
+
+    /// Constructs a frame from the given head bytes followed by the body owned by `owner`.
+    ///
+    /// \pre size <= head_capacity.
+    frame_t(const char* data, std::size_t size, std::shared_ptr<const void> owner, asio::const_buffer body) :
+        head_size(size),
+        owner(std::move(owner)),
+        body(body)
+    {
+        std::memcpy(head.data(), data, size);
+    }
+
+    /// Constructs a frame from the given head bytes followed by payload regions.
+    ///
+    /// \pre size <= head_capacity.
+    frame_t(const char* data, std::size_t size, std::vector<payload_t> payload) :
+        head_size(size),
+        payload(std::move(payload))
+    {
+        std::memcpy(head.data(), data, size);
+    }
+
+    /// Attaches the given headers to the frame.
+    ///
+    /// Only frames, which inline head starts with the message array header, i.e. the ones built by
+    /// the framework encoders, support headers.
+    ///
+    /// \throw std::logic_error if the frame does not support headers.
+    void
+    attach(std::vector<hpack::header_t> headers) {
+        if (head_size == 0 || static_cast<unsigned char>(head[0]) != 0x93) {
+            throw std::logic_error("frame does not support headers");
+        }
+
+        if (headers.empty()) {
+            return;
+        }
+
+        head[0] = static_cast<char>(0x94);
+        headers_ = std::move(headers);
+    }
+
+    /// Replaces the span the frame was encoded with.
+    ///
+    /// Allows to encode a message before its span is allocated. Only frames, which inline head
+    /// starts with the message array header followed by the span, i.e. the ones built by the
+    /// framework encoders, support rebinding.
+    ///
+    /// \throw std::logic_error if the frame does not support rebinding.
+    void
+    rebind(std::uint64_t span) {
+        if (head_size < 2) {
+            throw std::logic_error("frame does not support rebinding");
+        }
+
+        const auto code = static_cast<unsigned char>(head[0]);
+        const std::size_t width = detail::uint_size(head[1]);
+
+        if ((code != 0x93 && code != 0x94) || width == 0 || 1 + width > head_size) {
+            throw std::logic_error("frame does not support rebinding");
+        }
+
+        std::array<char, 9> packed;
+        const std::size_t size = detail::pack_uint(packed.data(), span);
+
+        if (head_size - width + size > head_capacity) {
+            throw std::length_error("frame head is too large");
+        }
+
+        std::memmove(head.data() + 1 + size, head.data() + 1 + width, head_size - 1 - width);
+        std::memcpy(head.data() + 1, packed.data(), size);
+        head_size = head_size - width + size;
+    }
+
+    /// Returns the headers attached to the frame.
+    const std::vector<hpack::header_t>&
+    headers() const noexcept {
+        return headers_;
+    }
+
+    /// Returns the total number of bytes in the frame, excluding its headers.
+    std::size_t
+    size() const noexcept {
+        std::size_t result = head_size + asio::buffer_size(body);
+        for (const auto& region : payload) {
+            result += region.size();
+        }
+
+        return result;
+    }
+
+    /// Appends the frame buffers to the given buffer sequence.
+    void
+    gather(std::vector<asio::const_buffer>& buffers) const {
+        if (head_size > 0) {
+            buffers.emplace_back(head.data(), head_size);
+        }
+
+        if (asio::buffer_size(body) > 0) {
+            buffers.push_back(body);
+        }
+
+        for (const auto& region : payload) {
+            if (region.size() > 0) {
+                buffers.emplace_back(region.data(), region.size());
+            }
+        }
+    }
+};
+
+typedef std::function<frame_t(std::uint64_t)> encode_callback_t;
+
+/// Encodes an event with the given arguments into a pooled buffer of the exact size.
+///
+/// The arguments are packed twice: first to compute their size without writing anything, then
+/// into a buffer drawn from the encoding pool, so the buffer is never reallocated while packing. The
+/// buffer returns to the pool once the frame is written and destroyed. The message array header,
+/// the span and the event id are kept in the frame head, which allows to attach headers and to
+/// rebind the frame.
+template<class Event, class... Args>
+frame_t
+encode_pooled(std::uint64_t span, const Args&... args) {
+    detail::counting_stream_t counter{ 0 };
+    {
+        msgpack::packer<detail::counting_stream_t> packer(counter);
+        detail::pack_args<Event>(packer, args...);
+    }
+
+    auto buffer = detail::encode_pool_t::instance().acquire(counter.size);
+
+    detail::region_stream_t region{ buffer->data() };
+    msgpack::packer<detail::region_stream_t> packer(region);
+    detail::pack_args<Event>(packer, args...);
+
+    std::array<char, frame_t::head_capacity> head;
+    char* it = head.data();
+
+    *it++ = static_cast<char>(0x93);
+    it += detail::pack_uint(it, span);
+    it += detail::pack_uint(it, io::event_traits<Event>::id);
+
+    const asio::const_buffer body(buffer->data(), counter.size);
+    return frame_t(head.data(), it - head.data(), std::move(buffer), body);
+}
 
 template<class Event, class... Args>
 static
-io::encoder_t::message_type
+frame_t
 encode(std::uint64_t span, Args&... args) {
-    return io::encoded<Event>(span, std::forward<Args>(args)...);
+    return encode_pooled<Event>(span, args...);
+}
+
+/// Pre-encoded frame of an event with constant arguments.
+///
+/// The arguments are encoded once at construction, so producing a frame for the given span costs
+/// only packing the span and the event id into the frame head. Short arguments, for example the
+/// empty ones of choke or heartbeat events, are copied into the head, longer ones are referenced.
+template<class Event>
+class frame_template_t {
+    std::shared_ptr<const msgpack::sbuffer> args;
+
+public:
+    template<class... Args>
+    explicit
+    frame_template_t(Args&&... args) {
+        auto buffer = std::make_shared<msgpack::sbuffer>();
+        msgpack::packer<msgpack::sbuffer> packer(*buffer);
+        io::type_traits<
+            typename io::event_traits<Event>::argument_type
+        >::pack(packer, std::forward<Args>(args)...);
+
+        this->args = std::move(buffer);
+    }
+
+    frame_t
+    operator()(std::uint64_t span) const {
+        std::array<char, frame_t::head_capacity> head;
+        char* it = head.data();
+
+        *it++ = static_cast<char>(0x93);
+        it += detail::pack_uint(it, span);
+        it += detail::pack_uint(it, io::event_traits<Event>::id);
+
+        // Arguments are inlined only if the frame can still be rebound to the widest span.
+        const std::size_t size = it - head.data();
+        if (args->size() + 9 - detail::uint_size(head[1]) <= head.size() - size) {
+            std::memcpy(it, args->data(), args->size());
+            return frame_t(head.data(), size + args->size(), std::vector<payload_t>());
+        }
+
+        return frame_t(head.data(), size, args, asio::const_buffer(args->data(), args->size()));
+    }
+};
+
+/// Encodes an event without arguments using its pre-encoded frame template.
+template<class Event>
+frame_t
+encode_constant(std::uint64_t span) {
+    static const frame_template_t<Event> frame;
+    return frame(span);
+}
+
+/// Encodes an event with a single string argument, which is the concatenation of the given payload
+/// regions, without copying them.
+///
+/// Only the frame head `[span, id, [<raw header>` is encoded, the regions are written after it by
+/// reference.
+template<class Event>
+frame_t
+encode_payload(std::uint64_t span, std::vector<payload_t> payload) {
+    static_assert(
+        boost::mpl::size<typename io::event_traits<Event>::argument_type>::value == 1,
+        "payload events must have exactly one argument"
+    );
+
+    std::size_t size = 0;
+    for (const auto& region : payload) {
+        size += region.size();
+    }
+
+    if (size > 0xffffffff) {
+        throw std::length_error("payload is too large");
+    }
+
+    std::array<char, frame_t::head_capacity> head;
+    char* it = head.data();
+
+    *it++ = static_cast<char>(0x93);
+    it += detail::pack_uint(it, span);
+    it += detail::pack_uint(it, io::event_traits<Event>::id);
+    *it++ = static_cast<char>(0x91);
+    it += detail::pack_raw_header(it, static_cast<std::uint32_t>(size));
+
+    return frame_t(head.data(), it - head.data(), std::move(payload));
 }
 
 }}
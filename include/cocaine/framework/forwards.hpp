@@ -34,8 +34,15 @@ namespace cocaine {
         /// \internal
         struct event_loop_t;
 
+        namespace detail {
+            /// \internal
+            class deadline_t;
+        } // namespace detail
+
         class scheduler_t;
 
+        struct socket_options_t;
+
         /// \internal
         class shared_state_t;
 
@@ -22,6 +22,7 @@
 
 #include "cocaine/framework/forwards.hpp"
 #include "cocaine/framework/session.hpp"
+#include "cocaine/framework/socket_options.hpp"
 
 namespace cocaine { namespace io {
     struct log_tag;
@@ -65,10 +66,14 @@ public:
     std::vector<endpoint_type>
     endpoints() const;
 
+    /// Creates the service with the given name, which connections are set up with the manager
+    /// socket options.
     template<class T>
     service<T>
     create(std::string name) {
-        return service<T>(logger(), std::move(name), endpoints(), next());
+        service<T> result(logger(), std::move(name), endpoints(), next());
+        result.socket_options(socket_options());
+        return result;
     }
 
     /// Returns a shared pointer to the associated logger service.
@@ -86,6 +91,18 @@ public:
     void
     shutdown_policy(shutdown_policy_t policy);
 
+    const socket_options_t&
+    socket_options() const;
+
+    /// Sets the socket options of the connections of services created afterwards, including the
+    /// logger.
+    ///
+    /// Each service can override them, see basic_service_t::socket_options.
+    ///
+    /// \warning this method is not thread-safe and should be called before services are created.
+    void
+    socket_options(socket_options_t options);
+
 private:
     void
     start(unsigned int threads);
@@ -18,6 +18,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 #include <stddef.h>
 
 #include <boost/none_t.hpp>
@@ -32,10 +34,42 @@ namespace msgpack { struct object; }
 namespace cocaine {
 namespace framework {
 
+namespace detail {
+
+class buffer_t;
+class zone_pool_t;
+
+} // namespace detail
+
 /// The decoded message class represents movable unpacked MessagePack payload with internal storage.
+///
+/// The message keeps its object and storage handles inline, so constructing or moving it never
+/// allocates by itself.
+///
+/// Messages decoded in place keep their arguments encoded until the object representation is
+/// requested, which allows typed receivers to unpack them directly without building the object
+/// tree.
 class decoded_message {
-    class inner_t;
-    std::unique_ptr<inner_t> d;
+    std::uint64_t span_;
+    std::uint64_t type_;
+
+    /// Encoded arguments, if the message has been decoded in place.
+    const char* raw;
+    std::size_t raw_size;
+
+    /// Object representation of arguments, unpacked into the zone on first access.
+    mutable msgpack::object args_;
+    mutable bool unpacked;
+
+    std::unique_ptr<msgpack::zone> zone;
+    std::shared_ptr<detail::zone_pool_t> pool;
+    std::vector<char> storage;
+    std::shared_ptr<const detail::buffer_t> buffer;
+    hpack::header_storage_t headers;
+
+    /// Positions of the first header with each name, ordered by name, built on first lookup.
+    mutable std::vector<std::size_t> index;
+    mutable bool indexed;
 
 public:
     /// Constructs a null-initialized message object.
@@ -51,10 +85,18 @@ public:
 
     decoded_message(msgpack::object, std::unique_ptr<msgpack::zone> zone, std::vector<char> storage, std::vector<hpack::header_t> headers);
 
+    /// Constructs a message object from its envelope and encoded arguments, which data is stored
+    /// in a shared read buffer.
+    ///
+    /// The message keeps the buffer alive until destroyed, no data copying is performed. The
+    /// arguments are unpacked into the zone on the first args() call. The zone is returned to the
+    /// given pool on destruction.
+    decoded_message(std::uint64_t span, std::uint64_t type, const char* args, std::size_t size, std::unique_ptr<msgpack::zone> zone, std::shared_ptr<detail::zone_pool_t> pool, std::shared_ptr<const detail::buffer_t> storage, std::vector<hpack::header_t> headers);
+
     ~decoded_message();
 
-    // TODO: Noexcept?
-    decoded_message(decoded_message&& other);
+    /// The moved-from message is left empty, as if it were null-initialized.
+    decoded_message(decoded_message&& other) noexcept;
     decoded_message& operator=(decoded_message&& other);
 
     /// Returns the message span id.
@@ -64,16 +106,34 @@ public:
     auto type() const -> std::uint64_t;
 
     /// Returns the object representation of message arguments.
+    ///
+    /// \note the first call unpacks the arguments of messages decoded in place, so it must not race
+    /// with other calls on the same message.
     auto args() const -> const msgpack::object&;
 
+    /// Returns the MessagePack encoded message arguments.
+    ///
+    /// The returned range is empty if the message owns only the object representation of its
+    /// arguments.
+    auto raw_args() const noexcept -> std::pair<const char*, std::size_t>;
+
     auto meta() const noexcept -> const std::vector<hpack::header_t>&;
 
+    /// Returns the first header with the given name if any.
+    ///
+    /// \note the first call builds the header index, so it must not race with other calls on the
+    /// same message.
     template<class Header>
     boost::optional<hpack::header_t>
     get_header() const {
-        return boost::optional<hpack::header_t>(hpack::header::find_first(meta(), Header::name()));
+        return find_header(Header::name());
     }
 
+private:
+    /// Makes the message empty after its storage has been moved out.
+    auto reset() noexcept -> void;
+
+    auto find_header(const hpack::header::data_t& name) const -> boost::optional<hpack::header_t>;
 };
 
 } // namespace framework
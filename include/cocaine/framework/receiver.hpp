@@ -17,6 +17,8 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 
@@ -42,21 +44,73 @@ template<class Session>
 class basic_receiver_t {
 public:
     typedef Session session_type;
+    typedef std::function<task<void>::future_type()> canceller_type;
 
 private:
     std::uint64_t id;
     std::shared_ptr<session_type> session;
     std::shared_ptr<shared_state_t> state;
 
+    /// The channel deadline, cancelled with the receiver.
+    std::shared_ptr<detail::deadline_t> deadline_;
+
+    /// Notifies the service to stop processing the channel, empty if the protocol does not allow
+    /// that.
+    canceller_type canceller;
+    /// Whether the channel is cancelled when the receiver is destroyed before it is finished.
+    bool cancel_abandoned;
+
+    /// Whether the service has sent the terminal message of the channel.
+    std::atomic<bool> finished;
+    std::atomic<bool> cancelled;
+
 public:
     basic_receiver_t(std::uint64_t id, std::shared_ptr<session_type> session, std::shared_ptr<shared_state_t> state);
 
+    /// Revokes the channel, cancelling it first if the cancel on abandon policy is set and the
+    /// channel is neither finished nor cancelled yet.
     ~basic_receiver_t();
 
+    /// Makes the channel cancellable remotely.
+    ///
+    /// The given callback is invoked on cancellation to notify the service. If `abandoned` is set,
+    /// the channel is also cancelled when the receiver is destroyed before the service has finished
+    /// it.
+    void
+    cancellable(canceller_type canceller, bool abandoned);
+
+    /// Marks the channel as finished by the service, so there is nothing to cancel anymore.
+    void
+    finish();
+
+    /// Cancels the channel.
+    ///
+    /// If the channel is cancellable and not finished, the service is notified to stop processing
+    /// it. The channel is then revoked, and both the pending and further receive operations fail
+    /// with the operation aborted error. Cancelling the channel again does nothing.
+    ///
+    /// \returns a future, which is set after the service is notified, immediately if there is
+    /// nothing to notify.
+    auto cancel() -> task<void>::future_type;
+
+    /// Sets the channel deadline.
+    ///
+    /// If the receiver is still alive after the given timeout, the channel is revoked, and both the
+    /// pending and further receive operations fail with the timed out error. Messages arrived later
+    /// are dropped.
+    void
+    deadline(std::chrono::milliseconds timeout);
+
     /// Returns a future with a decoded message received from the session.
     ///
     /// This future may throw std::system_error on any network failure.
     auto recv() -> task<decoded_message>::future_type;
+
+    /// Returns a future with a decoded message received from the session within the given timeout.
+    ///
+    /// If the message is not received in time the channel is revoked, as if its deadline has
+    /// expired, and the future throws std::system_error with the timed out error.
+    auto recv_for(std::chrono::milliseconds timeout) -> task<decoded_message>::future_type;
     cocaine::trace_t get_trace() const;
 };
 
@@ -69,9 +123,10 @@ public:
 
 private:
     typedef typename detail::result_of<receiver<T, session_type>>::type result_type;
-    typedef std::function<result_type(std::shared_ptr<basic_receiver_t<session_type>>, const msgpack::object&)> unpacker_type;
-
-    static const std::unordered_map<std::uint64_t, unpacker_type> unpackers;
+    typedef detail::dispatch<
+        typename result_type::types,
+        detail::unpacker_invoker<session_type, result_type>
+    > dispatch_type;
 
     std::shared_ptr<basic_receiver_t<session_type>> d;
 
@@ -128,20 +183,42 @@ public:
             .then(trace_t::bind(&receiver::convert, std::placeholders::_1, d));
     }
 
+    /// Performs receive asynchronous operation like recv, which fails with the timed out error if
+    /// no message is received within the given timeout, revoking the channel.
+    ///
+    /// \warning the current receiver will be invalidated after this call.
+    auto recv_for(std::chrono::milliseconds timeout) -> typename task<typename from_receiver<T, Session>::result_type>::future_type {
+        BOOST_ASSERT(this->d);
+
+        auto d = std::move(this->d);
+        auto future = d->recv_for(timeout);
+
+        trace_t::restore_scope_t scope(d->get_trace());
+        return future
+            .then(trace_t::bind(&receiver::convert, std::placeholders::_1, d));
+    }
+
+    /// Cancels the channel, see basic_receiver_t::cancel.
+    ///
+    /// \warning the current receiver will be invalidated after this call.
+    auto cancel() -> task<void>::future_type {
+        BOOST_ASSERT(this->d);
+
+        auto d = std::move(this->d);
+        return d->cancel();
+    }
+
 private:
     static inline
     typename from_receiver<T, Session>::result_type
     convert(task<decoded_message>::future_move_type future, std::shared_ptr<basic_receiver_t<session_type>> d) {
         const auto message = future.get();
-        const auto id = message.type();
-
-        auto it = unpackers.find(id);
 
-        if (it == std::end(unpackers)) {
-            throw std::runtime_error("invalid protocol");
+        if (detail::dispatch<typename io::protocol<T>::messages, detail::terminal>::apply(message.type())) {
+            d->finish();
         }
 
-        auto result = it->second(std::move(d), message.args());
+        auto result = dispatch_type::apply(message.type(), std::move(d), message);
         return from_receiver<T, Session>::transform(result);
     }
 };
@@ -169,10 +246,10 @@ public:
 
 private:
     typedef typename detail::variant_of<tag_type>::type result_type;
-    typedef std::function<result_type(const msgpack::object&)> unpacker_type;
-    typedef std::unordered_map<std::uint64_t, unpacker_type> unpackers_type;
-
-    static const unpackers_type unpackers;
+    typedef detail::dispatch<
+        typename result_type::types,
+        detail::unpacker_invoker<session_type, result_type>
+    > dispatch_type;
 
     std::shared_ptr<basic_receiver_t<session_type>> d;
 
@@ -201,20 +278,32 @@ public:
             .then(trace_t::bind(&receiver::convert, std::placeholders::_1, d));
     }
 
+    /// Performs receive asynchronous operation like recv, which fails with the timed out error if
+    /// no chunk is received within the given timeout, revoking the channel.
+    auto recv_for(std::chrono::milliseconds timeout) -> typename task<typename from_receiver<tag_type, Session>::result_type>::future_type {
+        auto future = d->recv_for(timeout);
+        return future
+            .then(trace_t::bind(&receiver::convert, std::placeholders::_1, d));
+    }
+
+    /// Cancels the channel, see basic_receiver_t::cancel.
+    ///
+    /// Further receive operations fail with the operation aborted error.
+    auto cancel() -> task<void>::future_type {
+        return d->cancel();
+    }
+
 private:
     static inline
     typename from_receiver<tag_type, Session>::result_type
-    convert(task<decoded_message>::future_move_type future, std::shared_ptr<basic_receiver_t<session_type>>) {
+    convert(task<decoded_message>::future_move_type future, std::shared_ptr<basic_receiver_t<session_type>> d) {
         const auto message = future.get();
-        const auto id = message.type();
 
-        auto it = unpackers.find(id);
-
-        if (it == std::end(unpackers)) {
-            throw std::runtime_error("invalid protocol");
+        if (detail::dispatch<typename io::protocol<tag_type>::messages, detail::terminal>::apply(message.type())) {
+            d->finish();
         }
 
-        auto payload = it->second(message.args());
+        auto payload = dispatch_type::apply(message.type(), message);
         return from_receiver<tag_type, Session>::transform(payload);
     }
 };
@@ -232,27 +321,6 @@ public:
     receiver(std::shared_ptr<basic_receiver_t<Session>>) {}
 };
 
-// Static unpackers variables initialization.
-template<class T, class Session>
-const std::unordered_map<
-    std::uint64_t,
-    typename receiver<T, Session>::unpacker_type
-> receiver<T, Session>::unpackers =
-    detail::to_map<
-        typename receiver<T, Session>::result_type::types,
-        detail::unpacker_factory<Session, typename receiver<T, Session>::unpacker_type>
-    >::make();
-
-template<class T, class Session>
-const std::unordered_map<
-    std::uint64_t,
-    typename receiver<io::streaming_tag<T>, Session>::unpacker_type
-> receiver<io::streaming_tag<T>, Session>::unpackers =
-    detail::to_map<
-        typename receiver<io::streaming_tag<T>, Session>::result_type::types,
-        detail::unpacker_factory<Session, typename receiver<io::streaming_tag<T>, Session>::unpacker_type>
-    >::make();
-
 } // namespace framework
 
 } // namespace cocaine
@@ -18,8 +18,9 @@
 
 #include <array>
 #include <cstdint>
+#include <stdexcept>
 #include <tuple>
-#include <unordered_map>
+#include <type_traits>
 
 #include <boost/mpl/at.hpp>
 #include <boost/mpl/front.hpp>
@@ -37,42 +38,74 @@
 
 #include "cocaine/framework/forwards.hpp"
 #include "cocaine/framework/error.hpp"
+#include "cocaine/framework/message.hpp"
+#include "cocaine/framework/unpack.hpp"
 
 namespace cocaine { namespace framework {
 
 namespace detail {
 
-/// Transforms a typelist sequence into an unordered map using the given metafunction.
+/// Dispatches a call to the metafunction instantiated with the typelist sequence element, which
+/// index matches the given runtime id.
+///
+/// Protocol message ids are dense and start from zero, so the dispatch unrolls into a chain of
+/// comparisons with inlined calls, which the compiler usually turns into a jump table, so there
+/// are neither hash lookups nor type-erased calls.
 ///
 /// \internal
-template<class Sequence, class F>
-struct to_map {
-    typedef Sequence sequence_type;
-    typedef typename F::result_type value_type;
-    static constexpr std::size_t size = boost::mpl::size<sequence_type>::value;
-
-    typedef std::unordered_map<std::uint64_t, value_type> result_type;
+template<class Sequence, class F, std::size_t Index = 0, std::size_t Size = boost::mpl::size<Sequence>::value>
+struct dispatch {
+    typedef typename F::result_type result_type;
 
-private:
-    template<class IndexSequence>
-    struct helper;
-
-    template<size_t... Index>
-    struct helper<index_sequence<Index...>> {
-        static inline
-        result_type
-        apply() {
-            return result_type {{
-                Index,
-                F::template apply<typename boost::mpl::at<sequence_type, boost::mpl::int_<Index>>::type>()
-            }...};
+    template<class... Args>
+    static inline
+    result_type
+    apply(std::uint64_t id, Args&&... args) {
+        if (id == Index) {
+            return F::template apply<
+                typename boost::mpl::at<Sequence, boost::mpl::int_<Index>>::type
+            >(std::forward<Args>(args)...);
         }
-    };
 
-public:
+        return dispatch<Sequence, F, Index + 1, Size>::apply(id, std::forward<Args>(args)...);
+    }
+};
+
+/// The terminal dispatch specialization, which is reached on unknown ids.
+///
+/// \internal
+template<class Sequence, class F, std::size_t Size>
+struct dispatch<Sequence, F, Size, Size> {
+    typedef typename F::result_type result_type;
+
+    template<class... Args>
+    static inline
+    result_type
+    apply(std::uint64_t, Args&&...) {
+        throw std::runtime_error("invalid protocol");
+    }
+};
+
+/// Checks whether the channel is closed after the given protocol message, i.e. whether the message
+/// has no dispatch protocol.
+///
+/// \internal
+template<class Event>
+struct is_terminal :
+    public std::is_same<typename io::event_traits<Event>::dispatch_type, void>
+{};
+
+/// Runtime visitor of the is_terminal trait for the dispatch.
+///
+/// \internal
+struct terminal {
+    typedef bool result_type;
+
+    template<class Event>
     static constexpr
-    result_type make() {
-        return helper<typename make_index_sequence<size>::type>::apply();
+    result_type
+    apply() {
+        return is_terminal<Event>::value;
     }
 };
 
@@ -212,6 +245,13 @@ struct unpacker<std::tuple<receiver<Tag, Session>, std::tuple<Args...>>, Session
         unpacker<std::tuple<Args...>, Session> up;
         return std::make_tuple(std::move(d), up(message));
     }
+
+    inline
+    std::tuple<receiver<Tag, Session>, std::tuple<Args...>>
+    operator()(std::shared_ptr<basic_receiver_t<Session>> d, const decoded_message& message) {
+        unpacker<std::tuple<Args...>, Session> up;
+        return std::make_tuple(std::move(d), up(message));
+    }
 };
 
 /// Unpacker template specialization for unpacking MessagePack'ed results for terminal receivers.
@@ -230,6 +270,13 @@ struct unpacker<std::tuple<Args...>, Session> {
         return up(message);
     }
 
+    inline
+    std::tuple<Args...>
+    operator()(std::shared_ptr<basic_receiver_t<Session>>, const decoded_message& message) {
+        unpacker<std::tuple<Args...>, Session> up;
+        return up(message);
+    }
+
     inline
     std::tuple<Args...>
     operator()(const msgpack::object& message) {
@@ -237,6 +284,26 @@ struct unpacker<std::tuple<Args...>, Session> {
         io::type_traits<std::tuple<Args...>>::unpack(message, result);
         return result;
     }
+
+    /// Unpacks the message arguments directly from their encoded representation if possible,
+    /// falling back to the object representation otherwise.
+    inline
+    std::tuple<Args...>
+    operator()(const decoded_message& message) {
+        typedef direct_unpack<std::tuple<Args...>> direct_type;
+
+        if (direct_type::supported) {
+            const auto raw = message.raw_args();
+
+            std::tuple<Args...> result;
+            const char* it = raw.first;
+            if (it && direct_type::unpack(it, raw.first + raw.second, result)) {
+                return result;
+            }
+        }
+
+        return (*this)(message.args());
+    }
 };
 
 /// The unpacked result trait provides an ability to unpack single-argument tuples implicitly.
@@ -275,18 +342,18 @@ struct unpacked_result<std::tuple<Args...>> {
     }
 };
 
-/// The metafunction to be used to fill static array with unpackers.
+/// The metafunction to be used to dispatch unpacking of the received message.
 ///
 /// \internal
 template<class Session, class Result>
-struct unpacker_factory {
+struct unpacker_invoker {
     typedef Result result_type;
 
-    template<class T>
+    template<class T, class... Args>
     static inline
     result_type
-    apply() {
-        return unpacker<T, Session>();
+    apply(Args&&... args) {
+        return unpacker<T, Session>()(std::forward<Args>(args)...);
     }
 };
 
@@ -18,9 +18,13 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
 
 #include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/receiver.inl.hpp"
 
 #include <cocaine/rpc/asio/encoder.hpp>
 
@@ -38,6 +42,11 @@ class basic_sender_t {
     std::uint64_t id;
     std::shared_ptr<session_type> session;
 
+    /// Orders closing the sender with sending frames.
+    std::mutex mutex;
+    /// Whether a terminal event has been sent, so the other side expects nothing more.
+    bool closed;
+
 public:
     basic_sender_t(std::uint64_t id, std::shared_ptr<session_type> session);
 
@@ -58,11 +67,56 @@ public:
     template<class Event, class... Args>
     auto
     send(Args&&... args) -> task<void>::future_type {
-        return send(io::encoded<Event>(id, std::forward<Args>(args)...));
+        return send(encode_pooled<Event>(id, args...), detail::is_terminal<Event>::value);
+    }
+
+    /// Sends an event without arguments.
+    ///
+    /// Such frames are constant except for the span, so they are built from a pre-encoded template
+    /// without running the encoder.
+    template<class Event>
+    auto
+    send() -> task<void>::future_type {
+        return send(encode_constant<Event>(id), detail::is_terminal<Event>::value);
+    }
+
+    /// Sends an event with a single string argument, which is the concatenation of the given
+    /// payload regions.
+    ///
+    /// The regions are written to the socket directly from the memory they own, without copying,
+    /// and are kept alive until then.
+    template<class Event>
+    auto
+    send_payload(std::vector<payload_t> payload) -> task<void>::future_type {
+        return send(encode_payload<Event>(id, std::move(payload)), detail::is_terminal<Event>::value);
+    }
+
+    /// Sends the given terminal event unless the sender is closed already, closing it.
+    ///
+    /// Used to interrupt the channel from a thread other than the one sending through it.
+    ///
+    /// \returns a future, which is set after the event is written, immediately if the sender is
+    /// closed already.
+    template<class Event, class... Args>
+    auto
+    interrupt(const Args&... args) -> task<void>::future_type {
+        static_assert(detail::is_terminal<Event>::value, "the interrupting event must be terminal");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed) {
+            return make_ready_future<void>::value();
+        }
+
+        closed = true;
+        return session->push(encode_pooled<Event>(id, args...));
     }
 
 private:
-    auto send(io::encoder_t::message_type&& message) -> task<void>::future_type;
+    /// Pushes the frame through the session unless the sender is closed, closing it if the frame is
+    /// terminal.
+    ///
+    /// Sending through a closed sender fails with the operation aborted error.
+    auto send(frame_t&& frame, bool terminal) -> task<void>::future_type;
 };
 
 template<class T, class Session>
@@ -105,6 +159,22 @@ public:
         return future.then(trace_t::bind(&sender::traverse<Event>, std::placeholders::_1, std::move(d)));
     }
 
+    /*!
+     * Push the event with a single string argument, built from the given payload regions without
+     * copying them, into the session attached.
+     *
+     * \warning this sender will be invalidated after this call.
+     */
+    template<class Event>
+    typename task<sender<typename io::event_traits<Event>::dispatch_type, Session>>::future_type
+    send_payload(std::vector<payload_t> payload) {
+        BOOST_ASSERT(this->d);
+
+        auto d = std::move(this->d);
+        auto future = d->template send_payload<Event>(std::move(payload));
+        return future.then(trace_t::bind(&sender::traverse<Event>, std::placeholders::_1, std::move(d)));
+    }
+
 private:
     template<class Event>
     static
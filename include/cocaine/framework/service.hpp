@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <type_traits>
+
 #include "cocaine/framework/forwards.hpp"
 #include "cocaine/framework/receiver.hpp"
 #include "cocaine/framework/service.inl.hpp"
@@ -44,7 +47,7 @@ public:
 private:
     class impl;
     std::unique_ptr<impl> d;
-    std::shared_ptr<session_t> session;
+    std::atomic<std::size_t> counter;
     scheduler_t& scheduler;
     internal_logger_t logger;
 
@@ -73,16 +76,73 @@ public:
 
     auto hard_shutdown(bool policy = true) -> void;
 
+    /// Sets the number of connections to the service.
+    ///
+    /// Each invocation is sent over the connection with the fewest pending channels, so a busy
+    /// service is served by several read loops and socket buffers, and a huge response delays only
+    /// the channels of its own connection. Connections are established lazily on first use. One
+    /// connection is used by default.
+    ///
+    /// Only channels are counted as pending, mute invocations leave no channel behind. So a
+    /// connection busy with mute traffic looks idle and is balanced by the rotating tie breaking
+    /// only.
+    ///
+    /// The number may be changed while the service is in use. Invocations keep the connection they
+    /// have selected, a removed connection is closed after its last user releases it.
+    auto connections(std::size_t count) -> void;
+
+    /// Sets the outbound cork bounds of the service connections.
+    ///
+    /// Messages sent while the connection is idle are held until either the given number of bytes
+    /// is queued or the given latency passes, trading latency for fewer write system calls.
+    auto cork(std::size_t bytes, std::chrono::microseconds latency) -> void;
+
+    /// Sets the outbound queue watermarks of the service connections.
+    ///
+    /// While more than `high` bytes are queued, futures of sent messages are not completed until
+    /// the queue drains to `low` bytes, which bounds the memory used by fast producers.
+    auto watermarks(std::size_t high, std::size_t low) -> void;
+
+    /// Sets the socket options of the service connections, overriding the ones given by the service
+    /// manager.
+    auto socket_options(const socket_options_t& options) -> void;
+
+    /// Sets whether channels are cancelled when their receivers are destroyed before the service
+    /// has finished them, see session::cancel_abandoned.
+    auto cancel_abandoned(bool policy = true) -> void;
+
+    /// Sets whether invocations of idempotent events are replayed after the connection breaks, see
+    /// basic_session_t::replay.
+    ///
+    /// While the background reconnection is enabled, replayed channels wait for the attempt which
+    /// succeeds, otherwise they fail with the next failed connect. Channels with deadlines expire
+    /// meanwhile as usual.
+    auto replay(bool policy = true) -> void;
+
+    /// Enables background reconnection with jittered exponential backoff.
+    ///
+    /// A broken connection is re-established through the Locator in the background after the given
+    /// initial delay, which doubles after each failed attempt up to `max`. Each delay is randomized
+    /// between its half and its whole. Invocations made meanwhile wait for the pending attempt
+    /// instead of connecting on their own. Zero initial delay, which is the default, disables it.
+    auto reconnect(std::chrono::milliseconds initial, std::chrono::milliseconds max) -> void;
+
+    /// Returns the number of received messages dropped, because their channels were revoked,
+    /// summed over the service connections.
+    std::uint64_t
+    orphans() const;
+
     /// Tries to connect to the service through the Locator.
     ///
-    /// \returns a future which is set after the connection is established.
+    /// \returns a future which is set after all connections are established.
     future<void>
     connect();
 
+    /// Returns the endpoint of the first connection.
     boost::optional<session_t::endpoint_type>
     endpoint() const;
 
-    /// Get the native socket representation.
+    /// Get the native socket representation of the first connection.
     ///
     /// This function may be used to obtain the underlying representation of the socket. This is
     /// intended to allow access to native socket functionality that is not otherwise provided.
@@ -96,12 +156,57 @@ public:
 
         trace::context_holder holder("SI");
 
-        return connect()
+        auto session = select();
+
+        // The session accepts invocations while connecting, queueing them until the connection is
+        // established, so the connect chain is required only when it is disconnected.
+        if (session->connected() || session->connecting()) {
+            return session->invoke<Event>(std::forward<Args>(args)...)
+                .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)));
+        }
+
+        return connect(session)
             .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_connect<Event, typename std::decay<Args>::type...>, ph::_1, session, std::forward<Args>(args)...)))
             .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)));
     }
 
+    /// Sends a mute event, which has no response, connecting to the service if required.
+    ///
+    /// Unlike `invoke` no channel is created, which makes fire-and-forget events, like logging
+    /// ones, much cheaper.
+    ///
+    /// \returns a future, which is set after the event is written.
+    template<class Event, class... Args>
+    typename task<void>::future_type
+    invoke_mute(Args&&... args) {
+        static_assert(
+            std::is_same<typename io::event_traits<Event>::upstream_type, void>::value,
+            "only mute events, which have no upstream, can be sent without a channel"
+        );
+
+        namespace ph = std::placeholders;
+
+        trace::context_holder holder("SM");
+
+        auto session = select();
+
+        if (session->connected() || session->connecting()) {
+            return session->invoke_mute<Event>(std::forward<Args>(args)...);
+        }
+
+        return connect(session)
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_connect_mute<Event, typename std::decay<Args>::type...>, ph::_1, session, std::forward<Args>(args)...)));
+    }
+
 private:
+    /// Returns the connection with the fewest pending channels.
+    std::shared_ptr<session_t>
+    select();
+
+    /// Connects the given session through the Locator unless it is already connected.
+    future<void>
+    connect(std::shared_ptr<session_t> session);
+
     template<class Event, class... Args>
     static
     typename task<channel<Event>>::future_type
@@ -112,6 +217,14 @@ private:
         return session->invoke<Event>(std::forward<Args>(args)...);
     }
 
+    template<class Event, class... Args>
+    static
+    typename task<void>::future_type
+    on_connect_mute(task<void>::future_move_type future, std::shared_ptr<session_t> session, Args&... args) {
+        future.get();
+        return session->invoke_mute<Event>(std::forward<Args>(args)...);
+    }
+
     template<class Event>
     static
     typename task<typename invocation_result<Event>::type>::future_type
@@ -16,9 +16,14 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <system_error>
+#include <type_traits>
 
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 
 #include "cocaine/framework/config.hpp"
 #include "cocaine/framework/channel.hpp"
@@ -27,6 +32,7 @@
 #include "cocaine/framework/receiver.hpp"
 #include "cocaine/framework/scheduler.hpp"
 #include "cocaine/framework/sender.hpp"
+#include "cocaine/framework/socket_options.hpp"
 #include "cocaine/framework/trace.hpp"
 
 #include <cocaine/idl/logging.hpp>
@@ -35,6 +41,16 @@ namespace cocaine {
 
 namespace framework {
 
+/// Marks events, which the service may safely handle more than once.
+///
+/// Specialize it for such events to replay their invocations after the connection breaks, see
+/// basic_session_t::replay. Only events without the client dispatch protocol are replayed, because
+/// messages sent through their senders can not be.
+///
+/// \helper
+template<class Event>
+struct idempotent : public std::false_type {};
+
 /*!
  * RAII class that manages with connection queue and returns a typed sender/receiver.
  */
@@ -43,6 +59,7 @@ class session {
 public:
     typedef BasicSession basic_session_type;
     typedef boost::asio::ip::tcp::endpoint endpoint_type;
+    typedef boost::asio::local::stream_protocol::endpoint local_endpoint_type;
 #if BOOST_VERSION > 104800
     typedef boost::asio::ip::tcp::socket::native_handle_type native_handle_type;
 #else
@@ -65,11 +82,58 @@ public:
 
     bool connected() const;
 
+    /// Checks whether the session is connecting, see basic_session_t::connecting.
+    bool connecting() const;
+
+    /// Returns the number of pending channels, see basic_session_t::load.
+    std::size_t load() const;
+
     auto connect(const endpoint_type& endpoint) -> task<void>::future_type;
     auto connect(const std::vector<endpoint_type>& endpoints) -> task<void>::future_type;
 
+    /// Connects to the local socket bound to the given path, see basic_session_t::connect.
+    auto connect(const local_endpoint_type& endpoint) -> task<void>::future_type;
+
     auto hard_shutdown(bool policy) -> void;
 
+    /// Sets whether channels are cancelled when their receivers are destroyed before the service
+    /// has finished them, see basic_receiver_t::cancel.
+    ///
+    /// The policy applies to channels invoked afterwards.
+    auto cancel_abandoned(bool policy) -> void;
+
+    /// Returns the number of received messages dropped, because their channels were revoked, see
+    /// basic_session_t::orphans.
+    std::uint64_t orphans() const;
+
+    /// Sets whether idempotent invocations are replayed after the connection breaks, see
+    /// basic_session_t::replay.
+    auto replay(bool policy) -> void;
+
+    /// Sets whether channels waiting for the replay survive failed connects, see
+    /// basic_session_t::retain_replays.
+    auto retain_replays(bool policy) -> void;
+
+    /// Fails the channels waiting for the replay, see basic_session_t::abandon_replays.
+    auto abandon_replays(const std::error_code& ec) -> void;
+
+    /// Sets the handler invoked when the established connection breaks, see
+    /// basic_session_t::disconnect_handler.
+    auto disconnect_handler(std::function<void(const std::error_code&)> handler) -> void;
+
+    /// Sets the outbound cork bounds, see basic_session_t::cork.
+    auto cork(std::size_t bytes, std::chrono::microseconds latency) -> void;
+
+    /// Sets the socket options, see basic_session_t::socket_options.
+    auto socket_options(const socket_options_t& options) -> void;
+
+    /// Sets the outbound queue watermarks, see basic_session_t::watermarks.
+    auto watermarks(std::size_t high, std::size_t low) -> void;
+
+    /// Returns a future, which becomes ready when the outbound queue is not throttled, see
+    /// basic_session_t::writable.
+    auto writable() -> task<void>::future_type;
+
     auto endpoint() const -> boost::optional<endpoint_type>;
 
     native_handle_type
@@ -83,18 +147,74 @@ public:
                     std::placeholders::_1,
                     std::forward<Args>(args)...
         );
-        return invoke(std::move(encode_cb)).then(scheduler, trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1));
+        return invoke(std::move(encode_cb), std::chrono::milliseconds::zero(), replayable<Event>::value)
+            .then(scheduler, trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1, cancels_abandoned()));
+    }
+
+    /// Sends an invocation event, which channel is revoked if it is still alive after the given
+    /// timeout.
+    ///
+    /// On expiration both pending and further receive operations of the channel fail with the timed
+    /// out error, see basic_receiver_t::deadline.
+    template<class Event, class... Args>
+    typename task<channel<Event>>::future_type
+    invoke_for(std::chrono::milliseconds timeout, Args&&... args) {
+        auto encode_cb = std::bind(
+                    &encode<Event, Args...>,
+                    std::placeholders::_1,
+                    std::forward<Args>(args)...
+        );
+        return invoke(std::move(encode_cb), timeout, replayable<Event>::value)
+            .then(scheduler, trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1, cancels_abandoned()));
+    }
+
+    /// Sends a mute event, which has no response, without creating a channel.
+    ///
+    /// \returns a future, which is set after the event is written.
+    template<class Event, class... Args>
+    typename task<void>::future_type
+    invoke_mute(Args&&... args) {
+        static_assert(
+            std::is_same<typename io::event_traits<Event>::upstream_type, void>::value,
+            "only mute events, which have no upstream, can be sent without a channel"
+        );
+
+        auto encode_cb = std::bind(
+                    &encode<Event, Args...>,
+                    std::placeholders::_1,
+                    std::forward<Args>(args)...
+        );
+        return invoke_mute(std::move(encode_cb));
     }
 
 private:
+    template<class Event>
+    struct replayable :
+        public std::integral_constant<
+            bool,
+            idempotent<Event>::value && detail::is_terminal<Event>::value
+        >
+    {};
+
     task<basic_invoke_result>::future_type
-    invoke(encode_callback_t encode_callback);
+    invoke(encode_callback_t encode_callback, std::chrono::milliseconds timeout, bool idempotent);
+
+    task<void>::future_type
+    invoke_mute(encode_callback_t encode_callback);
+
+    bool cancels_abandoned() const;
 
     template<class Event>
     static
     channel<Event>
-    on_invoke(task<basic_invoke_result>::future_move_type future) {
-        return channel<Event>(future.get());
+    on_invoke(task<basic_invoke_result>::future_move_type future, bool abandoned) {
+        auto result = future.get();
+
+        detail::cancel_traits<typename io::event_traits<Event>::dispatch_type>::apply(
+            std::get<0>(result), *std::get<1>(result), abandoned
+        );
+
+        return channel<Event>(std::move(result));
     }
 };
 
@@ -0,0 +1,52 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+
+#include <boost/optional/optional.hpp>
+
+namespace cocaine { namespace framework {
+
+/// Options applied to session sockets.
+///
+/// Unset options keep the system defaults. Options the platform does not support are ignored, TCP
+/// ones are ignored for local sockets.
+struct socket_options_t {
+    /// Disables the Nagle algorithm (TCP_NODELAY), so small messages are sent immediately.
+    boost::optional<bool> nodelay;
+
+    /// Kernel send and receive buffer sizes in bytes (SO_SNDBUF and SO_RCVBUF).
+    boost::optional<int> send_buffer;
+    boost::optional<int> receive_buffer;
+
+    /// Acknowledges received segments immediately instead of delaying them (TCP_QUICKACK).
+    ///
+    /// The kernel may fall back to delayed acknowledgements on its own, so the option is set again
+    /// after each read.
+    boost::optional<bool> quickack;
+
+    /// Busy polls the device queue for the given time on blocking receives and selects
+    /// (SO_BUSY_POLL).
+    boost::optional<std::chrono::microseconds> busy_poll;
+
+    /// Breaks the connection if sent data stays unacknowledged for the given time
+    /// (TCP_USER_TIMEOUT).
+    boost::optional<std::chrono::milliseconds> user_timeout;
+};
+
+}} // namespace cocaine::framework
@@ -0,0 +1,333 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Reads a big-endian unsigned integer of the given width.
+///
+/// \internal
+inline
+std::uint64_t
+load_be(const char* data, std::size_t width) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < width; ++i) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+
+    return value;
+}
+
+/// Reads the MessagePack array header, returning the number of its elements.
+///
+/// \internal
+inline
+bool
+unpack_array_header(const char*& it, const char* end, std::uint64_t& size) {
+    if (it == end) {
+        return false;
+    }
+
+    const auto type = static_cast<unsigned char>(*it);
+    std::size_t width = 0;
+
+    if (type >= 0x90 && type <= 0x9f) {
+        size = type & 0x0f;
+    } else if (type == 0xdc) {
+        width = 2;
+    } else if (type == 0xdd) {
+        width = 4;
+    } else {
+        return false;
+    }
+
+    if (static_cast<std::size_t>(end - it) < 1 + width) {
+        return false;
+    }
+
+    if (width > 0) {
+        size = load_be(it + 1, width);
+    }
+
+    it += 1 + width;
+    return true;
+}
+
+/// Unpacks values of the given type directly from MessagePack encoded bytes, without building the
+/// object tree.
+///
+/// Each specialization advances the iterator past the value on success. On failure, including any
+/// type mismatch, it returns false, leaving both the iterator and the value in an unspecified
+/// state. The primary template unpacks nothing, so callers are expected to fall back to the
+/// object representation.
+///
+/// \internal
+template<class T, class = void>
+struct direct_unpack {
+    static constexpr bool supported = false;
+
+    static inline
+    bool
+    unpack(const char*&, const char*, T&) {
+        return false;
+    }
+};
+
+template<>
+struct direct_unpack<bool> {
+    static constexpr bool supported = true;
+
+    static inline
+    bool
+    unpack(const char*& it, const char* end, bool& value) {
+        if (it == end) {
+            return false;
+        }
+
+        switch (static_cast<unsigned char>(*it)) {
+        case 0xc2:
+            value = false;
+            break;
+        case 0xc3:
+            value = true;
+            break;
+        default:
+            return false;
+        }
+
+        ++it;
+        return true;
+    }
+};
+
+/// Integer specialization, which fails on values not representable in the target type.
+///
+/// \internal
+template<class T>
+struct direct_unpack<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    static constexpr bool supported = true;
+
+    static inline
+    bool
+    unpack(const char*& it, const char* end, T& value) {
+        if (it == end) {
+            return false;
+        }
+
+        const auto type = static_cast<unsigned char>(*it);
+
+        std::size_t width = 0;
+        bool sign = false;
+
+        if (type <= 0x7f || type >= 0xe0) {
+            // Positive or negative fixint.
+            if (!assign(static_cast<std::int64_t>(static_cast<std::int8_t>(type)), value)) {
+                return false;
+            }
+
+            ++it;
+            return true;
+        } else if (type >= 0xcc && type <= 0xcf) {
+            width = std::size_t(1) << (type - 0xcc);
+        } else if (type >= 0xd0 && type <= 0xd3) {
+            width = std::size_t(1) << (type - 0xd0);
+            sign = true;
+        } else {
+            return false;
+        }
+
+        if (static_cast<std::size_t>(end - it) < 1 + width) {
+            return false;
+        }
+
+        const auto raw = load_be(it + 1, width);
+
+        bool ok;
+        if (sign) {
+            // Sign-extend the value from its width.
+            const auto shift = 64 - 8 * width;
+            ok = assign(static_cast<std::int64_t>(raw << shift) >> shift, value);
+        } else {
+            ok = assign(raw, value);
+        }
+
+        if (ok) {
+            it += 1 + width;
+        }
+
+        return ok;
+    }
+
+private:
+    static inline
+    bool
+    assign(std::int64_t source, T& value) {
+        if (source >= 0) {
+            return assign(static_cast<std::uint64_t>(source), value);
+        }
+
+        if (!std::is_signed<T>::value || source < static_cast<std::int64_t>(std::numeric_limits<T>::min())) {
+            return false;
+        }
+
+        value = static_cast<T>(source);
+        return true;
+    }
+
+    static inline
+    bool
+    assign(std::uint64_t source, T& value) {
+        if (source > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+
+        value = static_cast<T>(source);
+        return true;
+    }
+};
+
+template<>
+struct direct_unpack<std::string> {
+    static constexpr bool supported = true;
+
+    static inline
+    bool
+    unpack(const char*& it, const char* end, std::string& value) {
+        if (it == end) {
+            return false;
+        }
+
+        const auto type = static_cast<unsigned char>(*it);
+
+        std::size_t width = 0;
+        std::uint64_t size = 0;
+
+        if (type >= 0xa0 && type <= 0xbf) {
+            size = type & 0x1f;
+        } else if (type >= 0xd9 && type <= 0xdb) {
+            width = std::size_t(1) << (type - 0xd9);
+        } else {
+            return false;
+        }
+
+        if (static_cast<std::size_t>(end - it) < 1 + width) {
+            return false;
+        }
+
+        if (width > 0) {
+            size = load_be(it + 1, width);
+        }
+
+        if (static_cast<std::uint64_t>(end - it) - 1 - width < size) {
+            return false;
+        }
+
+        value.assign(it + 1 + width, size);
+        it += 1 + width + size;
+        return true;
+    }
+};
+
+template<class T>
+struct direct_unpack<std::vector<T>> {
+    static constexpr bool supported = direct_unpack<T>::supported;
+
+    static inline
+    bool
+    unpack(const char*& it, const char* end, std::vector<T>& value) {
+        std::uint64_t size;
+        if (!unpack_array_header(it, end, size)) {
+            return false;
+        }
+
+        // Each element takes at least one byte, which bounds the reservation for malformed sizes.
+        if (size > static_cast<std::uint64_t>(end - it)) {
+            return false;
+        }
+
+        value.clear();
+        value.reserve(size);
+
+        for (std::uint64_t id = 0; id < size; ++id) {
+            value.emplace_back();
+            if (!direct_unpack<T>::unpack(it, end, value.back())) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+/// Tuple specialization, which expects an array of exactly the tuple size.
+///
+/// Shorter arrays, for example those with optional arguments omitted, are left to the object
+/// representation.
+///
+/// \internal
+template<class... Args>
+struct direct_unpack<std::tuple<Args...>> {
+private:
+    template<std::size_t Index, class Dummy = void>
+    struct element {
+        typedef typename std::tuple_element<Index - 1, std::tuple<Args...>>::type type;
+
+        static constexpr bool supported =
+            direct_unpack<type>::supported && element<Index - 1>::supported;
+
+        static inline
+        bool
+        unpack(const char*& it, const char* end, std::tuple<Args...>& value) {
+            return element<Index - 1>::unpack(it, end, value) &&
+                direct_unpack<type>::unpack(it, end, std::get<Index - 1>(value));
+        }
+    };
+
+    template<class Dummy>
+    struct element<0, Dummy> {
+        static constexpr bool supported = true;
+
+        static inline
+        bool
+        unpack(const char*&, const char*, std::tuple<Args...>&) {
+            return true;
+        }
+    };
+
+public:
+    static constexpr bool supported = element<sizeof...(Args)>::supported;
+
+    static inline
+    bool
+    unpack(const char*& it, const char* end, std::tuple<Args...>& value) {
+        std::uint64_t size;
+        if (!unpack_array_header(it, end, size) || size != sizeof...(Args)) {
+            return false;
+        }
+
+        return element<sizeof...(Args)>::unpack(it, end, value);
+    }
+};
+
+}}} // namespace cocaine::framework::detail
@@ -21,6 +21,7 @@
 #include <string>
 
 #include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/socket_options.hpp"
 #include "cocaine/framework/worker/dispatch.hpp"
 #include "cocaine/framework/worker/options.hpp"
 
@@ -75,6 +76,25 @@ public:
     auto
     options() const -> const options_t&;
 
+    /// Sets the watermarks of the queue of messages written to the runtime.
+    ///
+    /// While more than `high` bytes are queued, futures returned by senders are not completed until
+    /// the queue drains to `low` bytes, so handlers streaming data are slowed down to the socket
+    /// speed. Zero high watermark, which is the default, disables throttling.
+    ///
+    /// \pre should be called before `run`.
+    void
+    watermarks(std::size_t high, std::size_t low);
+
+    /// Sets the options of the socket connected to the runtime.
+    ///
+    /// Only options applicable to local sockets, like buffer sizes, take effect. Services created
+    /// through the manager use the manager options instead.
+    ///
+    /// \pre should be called before `run`.
+    void
+    socket_options(socket_options_t options);
+
     int
     run();
 };
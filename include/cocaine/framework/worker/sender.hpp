@@ -18,9 +18,11 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <cocaine/forwards.hpp>
 
+#include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/forwards.hpp"
 
 namespace cocaine {
@@ -50,6 +52,19 @@ public:
     ///     involve rvalue reference from this, but our compilers doesn't support it yey.
     auto write(std::string message) -> task<sender>::future_type;
 
+    /// Writes the provided immutable buffer into the associated channel without copying it.
+    ///
+    /// The buffer is kept alive until it is written to the socket.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto write(payload_t message) -> task<sender>::future_type;
+
+    /// Writes the concatenation of the provided immutable buffers into the associated channel as a
+    /// single chunk without copying them.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto write(std::vector<payload_t> message) -> task<sender>::future_type;
+
     /// Sends an error into the associated channel.
     ///
     /// \warning this sender will be invalidated after this call. The proper signature should
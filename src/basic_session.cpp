@@ -17,8 +17,9 @@
 #include "cocaine/framework/detail/basic_session.hpp"
 
 #include <memory>
+#include <set>
 
-#include <asio/connect.hpp>
+#include <asio/error.hpp>
 
 #include "cocaine/framework/sender.hpp"
 #include "cocaine/framework/scheduler.hpp"
@@ -41,18 +42,21 @@ using namespace cocaine::framework::detail;
 class basic_session_t::push_t:
     public std::enable_shared_from_this<push_t>
 {
-    const io::encoder_t::message_type message;
+    const frame_t frame;
 
     // Keeps the session alive until all the operations are complete.
     const std::shared_ptr<basic_session_t> session;
 
+    // The transport the frame is written to, which errors are attributed to.
+    std::weak_ptr<transport_type> transport;
+
     promise<void> pr;
 
 public:
-    push_t(io::encoder_t::message_type&& message,
+    push_t(frame_t&& frame,
            std::shared_ptr<basic_session_t> session,
            promise<void>&& pr) :
-        message(std::move(message)),
+        frame(std::move(frame)),
         session(std::move(session)),
         pr(std::move(pr))
     {}
@@ -61,8 +65,9 @@ public:
     operator()(std::shared_ptr<transport_type> transport) {
         CF_DBG("writing message ...");
 
+        this->transport = transport;
         transport->writer->write(
-            message,
+            frame,
             trace::wrap(std::bind(&push_t::on_write, shared_from_this(), ph::_1))
         );
     }
@@ -73,7 +78,7 @@ private:
         CF_DBG("<< write: %s", CF_EC(ec));
 
         if (ec) {
-            session->on_error(ec);
+            session->on_error(ec, transport);
             pr.set_exception(std::system_error(ec));
         } else {
             pr.set_value();
@@ -81,13 +86,102 @@ private:
     }
 };
 
+/// Tries the given endpoints one by one until the connection is established, recording the outcome
+/// of each attempt in the session endpoint statistics.
+///
+/// \note single shot.
+class basic_session_t::connect_t:
+    public std::enable_shared_from_this<connect_t>
+{
+    typedef detail::endpoint_stats_t::clock_type clock_type;
+
+    const std::vector<protocol_type::endpoint> endpoints;
+    std::size_t id;
+    clock_type::time_point start;
+
+    std::unique_ptr<socket_type> socket;
+    const socket_options_t options;
+
+    // Keeps the session alive until all the operations are complete.
+    const std::shared_ptr<basic_session_t> session;
+
+    promise<std::error_code> pr;
+
+public:
+    connect_t(std::vector<protocol_type::endpoint> endpoints,
+              std::unique_ptr<socket_type> socket,
+              socket_options_t options,
+              std::shared_ptr<basic_session_t> session,
+              promise<std::error_code>&& pr) :
+        endpoints(std::move(endpoints)),
+        id(0),
+        socket(std::move(socket)),
+        options(std::move(options)),
+        session(std::move(session)),
+        pr(std::move(pr))
+    {}
+
+    void
+    operator()() {
+        BOOST_ASSERT(id < endpoints.size());
+
+        // The socket is opened beforehand, so the options, buffer sizes especially, are applied
+        // before the handshake.
+        std::error_code ec;
+        socket->open(endpoints[id].protocol(), ec);
+        if (!ec) {
+            ec = detail::apply(socket->native_handle(), options, is_tcp(endpoints[id]));
+            if (ec) {
+                CF_DBG("failed to apply socket options: %s", CF_EC(ec));
+            }
+        }
+
+        start = clock_type::now();
+        socket->async_connect(
+            endpoints[id],
+            trace::wrap(std::bind(&connect_t::on_connect, shared_from_this(), ph::_1))
+        );
+    }
+
+private:
+    void
+    on_connect(const std::error_code& ec) {
+        const auto& endpoint = endpoints[id];
+
+        if (ec) {
+            CF_DBG("<< connect to endpoint #%llu: %s", CF_US(id), CF_EC(ec));
+            session->stats.failure(endpoint);
+
+            if (ec != asio::error::operation_aborted && ++id < endpoints.size()) {
+                std::error_code ignored;
+                socket->close(ignored);
+                (*this)();
+                return;
+            }
+        } else {
+            session->stats.success(endpoint, clock_type::now() - start);
+        }
+
+        session->on_connect(ec, endpoint, std::move(pr), socket);
+    }
+};
+
 basic_session_t::basic_session_t(scheduler_t& scheduler) noexcept :
     scheduler(scheduler),
     closed(false),
     state(0),
     counter(1),
-    message(boost::none),
-    hard_shutdown_(false)
+    cork_bytes(0),
+    cork_latency(0),
+    high_watermark(0),
+    low_watermark(0),
+    quickacked(0),
+    hard_shutdown_(false),
+    cancel_abandoned_(false),
+    replay_(false),
+    retain_replays_(false),
+    replayable(0),
+    orphans_(0)
 {}
 
 basic_session_t::~basic_session_t() {}
@@ -96,12 +190,37 @@ bool basic_session_t::connected() const noexcept {
     return state == static_cast<int>(state_t::connected);
 }
 
+bool
+basic_session_t::connecting() const noexcept {
+    return state == static_cast<int>(state_t::connecting);
+}
+
+std::size_t
+basic_session_t::load() const noexcept {
+    return channels.size();
+}
+
 auto basic_session_t::connect(const endpoint_type& endpoint) -> task<std::error_code>::future_type {
     return connect(std::vector<endpoint_type> {{ endpoint }});
 }
 
 framework::future<std::error_code>
 basic_session_t::connect(const std::vector<endpoint_type>& endpoints) {
+    std::vector<protocol_type::endpoint> generic;
+    for (const auto& endpoint : endpoints) {
+        generic.emplace_back(endpoint_cast(endpoint));
+    }
+
+    return connect(std::move(generic));
+}
+
+framework::future<std::error_code>
+basic_session_t::connect(const local_endpoint_type& endpoint) {
+    return connect(std::vector<protocol_type::endpoint> { protocol_type::endpoint(endpoint_cast(endpoint)) });
+}
+
+framework::future<std::error_code>
+basic_session_t::connect(std::vector<protocol_type::endpoint> endpoints) {
     CF_CTX("bC");
     CF_DBG(">> connecting ...");
 
@@ -120,22 +239,30 @@ basic_session_t::connect(const std::vector<endpoint_type>& endpoints) {
         } catch (const std::exception& err) {
             CF_DBG("<< failed: %s", err.what());
 
-            state = static_cast<int>(state_t::disconnected);
+            on_connect_failed(asio::error::not_connected);
             pr.set_exception(err);
             return fr;
         }
 
-        const auto converted = endpoints_cast<asio::ip::tcp::endpoint>(endpoints);
+        auto ordered = stats.order(std::move(endpoints));
+        if (ordered.empty()) {
+            CF_DBG("<< failed: no endpoints");
+
+            on_connect_failed(asio::error::not_found);
+            pr.set_value(asio::error::not_found);
+            return fr;
+        }
+
+        socket_options_t options;
+        {
+            auto transport = this->transport.synchronize();
+            options = socket_options_;
+        }
 
-        socket_type& socket_ref = *socket;
-        asio::async_connect(
-            socket_ref,
-            converted.begin(), converted.end(),
-            trace::wrap(trace_t::bind(
-				&basic_session_t::on_connect,
-                shared_from_this(), ph::_1, std::move(pr), std::move(socket)
-			))
+        auto connector = std::make_shared<connect_t>(
+            std::move(ordered), std::move(socket), std::move(options), shared_from_this(), std::move(pr)
         );
+        (*connector)();
     } else {
         // The transport was in other state.
 
@@ -160,15 +287,150 @@ auto basic_session_t::hard_shutdown(bool policy) -> void {
     hard_shutdown_ = policy;
 }
 
+void
+basic_session_t::cancel_abandoned(bool policy) noexcept {
+    cancel_abandoned_ = policy;
+}
+
+bool
+basic_session_t::cancels_abandoned() const noexcept {
+    return cancel_abandoned_;
+}
+
+void
+basic_session_t::replay(bool policy) noexcept {
+    replay_ = policy;
+}
+
+void
+basic_session_t::retain_replays(bool policy) noexcept {
+    retain_replays_ = policy;
+}
+
+void
+basic_session_t::abandon_replays(const std::error_code& ec) {
+    std::vector<std::uint64_t> spans;
+    {
+        std::lock_guard<std::mutex> lock(replay_mutex);
+        for (const auto& item : replaying) {
+            spans.push_back(item.first);
+        }
+
+        replayable -= replaying.size();
+        replaying.clear();
+    }
+
+    for (auto span : spans) {
+        if (auto state = channels.find(span)) {
+            channels.erase(span);
+            state->put(ec);
+        }
+    }
+}
+
+void
+basic_session_t::disconnect_handler(disconnect_handler_type handler) {
+    auto transport = this->transport.synchronize();
+    disconnect_handler_ = std::move(handler);
+}
+
+std::uint64_t
+basic_session_t::orphans() const noexcept {
+    return orphans_;
+}
+
+void
+basic_session_t::cork(std::size_t bytes, std::chrono::microseconds latency) {
+    auto transport = this->transport.synchronize();
+
+    cork_bytes = bytes;
+    cork_latency = latency;
+
+    if (*transport) {
+        (*transport)->writer->cork(bytes, latency);
+    }
+}
+
+void
+basic_session_t::socket_options(const socket_options_t& options) {
+    auto transport = this->transport.synchronize();
+
+    socket_options_ = options;
+
+    if (*transport) {
+        const auto ec = detail::apply((*transport)->socket->native_handle(), options, is_tcp(remote));
+        if (ec) {
+            CF_DBG("failed to apply socket options: %s", CF_EC(ec));
+        }
+    }
+}
+
+void
+basic_session_t::watermarks(std::size_t high, std::size_t low) {
+    auto transport = this->transport.synchronize();
+
+    high_watermark = high;
+    low_watermark = low;
+
+    if (*transport) {
+        (*transport)->writer->watermarks(high, low);
+    }
+}
+
+framework::future<void>
+basic_session_t::writable() {
+    auto pr = std::make_shared<promise<void>>();
+    auto fr = pr->get_future();
+
+    auto transport = *this->transport.synchronize();
+    if (transport) {
+        transport->writer->writable([pr](const std::error_code& ec) {
+            if (ec) {
+                pr->set_exception(std::system_error(ec));
+            } else {
+                pr->set_value();
+            }
+        });
+    } else {
+        pr->set_exception(std::system_error(asio::error::not_connected));
+    }
+
+    return fr;
+}
+
 boost::optional<basic_session_t::endpoint_type>
 basic_session_t::endpoint() const {
-    // TODO: Implement `basic_session_t::endpoint()`.
+    auto transport = this->transport.synchronize();
+    if (*transport && connected() && is_tcp(remote)) {
+        return endpoint_cast(tcp_cast(remote));
+    }
+
     return boost::none;
 }
 
+detail::endpoint_stats_t::stats_t
+basic_session_t::endpoint_stats(const endpoint_type& endpoint) const {
+    return stats.get(protocol_type::endpoint(endpoint_cast(endpoint)));
+}
+
 basic_session_t::native_handle_type
 basic_session_t::native_handle() const {
-    return (*transport.synchronize())->socket->native_handle();
+    auto transport = *this->transport.synchronize();
+    if (transport) {
+        return transport->socket->native_handle();
+    }
+
+    return -1;
+}
+
+detail::zone_pool_t::stats_t
+basic_session_t::zone_stats() const {
+    auto transport = *this->transport.synchronize();
+    if (transport) {
+        return transport->reader->zone_stats();
+    }
+
+    return detail::zone_pool_t::stats_t{ 0, 0 };
 }
 
 void
@@ -176,7 +438,11 @@ basic_session_t::cancel() {
     CF_DBG(">> disconnecting ...");
 
     closed = true;
-    if (channels->empty() || hard_shutdown_) {
+
+    // Nobody reconnects a closed session.
+    abandon_replays(asio::error::operation_aborted);
+
+    if (channels.empty() || hard_shutdown_) {
         CF_DBG("<< stop listening");
         transport.synchronize()->reset();
     }
@@ -185,53 +451,114 @@ basic_session_t::cancel() {
 }
 
 framework::future<basic_session_t::invoke_result>
-basic_session_t::invoke(encode_callback_t encode_callback) {
-    // Synchronization here is required to prevent channel id mixing in multi-threaded environment.
-    std::lock_guard<std::mutex> lock(mutex);
+basic_session_t::invoke(encode_callback_t encode_callback, std::chrono::milliseconds timeout, bool idempotent) {
+    // The frame is encoded outside of the lock and rebound to the allocated span later.
+    auto frame = encode_callback(0);
 
-    const auto span = counter++;
+    auto state = std::make_shared<shared_state_t>();
+
+    promise<void> pr;
+    auto fr = pr.get_future();
+
+    const auto span = push_invoke(std::move(frame), state, std::move(pr), idempotent && replay_);
 
     CF_CTX("bI" + std::to_string(span));
     CF_DBG("invoking span %llu event ...", CF_US(span));
 
-    auto tx    = std::make_shared<basic_sender_t<basic_session_t>>(span, shared_from_this());
-    auto state = std::make_shared<shared_state_t>();
-    auto rx    = std::make_shared<basic_receiver_t<basic_session_t>>(span, shared_from_this(), state);
+    auto tx = std::make_shared<basic_sender_t<basic_session_t>>(span, shared_from_this());
+    auto rx = std::make_shared<basic_receiver_t<basic_session_t>>(span, shared_from_this(), std::move(state));
+
+    if (timeout != std::chrono::milliseconds::zero()) {
+        rx->deadline(timeout);
+    }
 
-    channels->insert(std::make_pair(span, std::move(state)));
-    return push(encode_callback(span))
-        .then(scheduler, trace::wrap([tx, rx](future<void>& fr) -> invoke_result {
-            fr.get();
-            return std::make_tuple(tx, rx);
-        }));
+    return fr.then(scheduler, trace::wrap([tx, rx](future<void>& fr) -> invoke_result {
+        fr.get();
+        return std::make_tuple(tx, rx);
+    }));
+}
+
+framework::future<void>
+basic_session_t::invoke_mute(encode_callback_t encode_callback) {
+    auto frame = encode_callback(0);
+
+    promise<void> pr;
+    auto fr = pr.get_future();
+
+    const auto span = push_invoke(std::move(frame), nullptr, std::move(pr));
+
+    CF_DBG("invoking span %llu mute event ...", CF_US(span));
+
+    return fr;
+}
+
+std::uint64_t
+basic_session_t::push_invoke(frame_t&& frame, std::shared_ptr<shared_state_t> state, promise<void> pr, bool replay) {
+    // The remote side requires spans of new channels to increase, so allocating the span and
+    // queueing the frame must be atomic with respect to other invocations.
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto span = counter++;
+    frame.rebind(span);
+
+    if (state) {
+        channels.insert(span, std::move(state));
+    }
+
+    if (replay) {
+        // Frames share their encoded payload, so keeping a copy is cheap.
+        std::lock_guard<std::mutex> lock(replay_mutex);
+        replays.insert(std::make_pair(span, frame));
+        ++replayable;
+    }
+
+    push(std::move(frame), std::move(pr));
+
+    return span;
 }
 
 framework::future<void>
 basic_session_t::push(io::encoder_t::message_type&& message) {
-    CF_CTX("bP");
-    CF_DBG(">> writing message ...");
+    return push(frame_t(std::move(message)));
+}
 
+framework::future<void>
+basic_session_t::push(frame_t&& frame) {
     promise<void> pr;
     auto fr = pr.get_future();
 
-    auto transport = *this->transport.synchronize();
-    if (transport) {
-        auto pusher = std::make_shared<push_t>(std::move(message), shared_from_this(), std::move(pr));
-        (*pusher)(transport);
+    push(std::move(frame), std::move(pr));
+
+    return fr;
+}
+
+void
+basic_session_t::push(frame_t&& frame, promise<void> pr) {
+    CF_CTX("bP");
+    CF_DBG(">> writing message ...");
+
+    // The transport of a broken connection is dropped, but the state is checked first anyway, so
+    // frames sent while reconnecting are queued for the new connection.
+    auto transport = this->transport.synchronize();
+    if (connected() && *transport) {
+        auto pusher = std::make_shared<push_t>(std::move(frame), shared_from_this(), std::move(pr));
+        (*pusher)(*transport);
+    } else if (connecting()) {
+        CF_DBG("<< queued until connected");
+        backlog.emplace_back(std::move(frame), std::move(pr));
     } else {
         pr.set_exception(std::system_error(asio::error::not_connected));
     }
-
-    return fr;
 }
 
 void
 basic_session_t::revoke(std::uint64_t span) {
     CF_DBG(">> revoking span %llu channel", CF_US(span));
 
-    auto channels = this->channels.synchronize();
-    channels->erase(span);
-    if (closed && channels->empty()) {
+    channels.erase(span);
+    settle(span);
+
+    if (closed && channels.empty()) {
         // At this moment there are no references left to this session and also nobody is intrested
         // for data reading.
         CF_DBG("<< stop listening");
@@ -242,20 +569,74 @@ basic_session_t::revoke(std::uint64_t span) {
 }
 
 void
-basic_session_t::on_connect(const std::error_code& ec, promise<std::error_code> pr, std::unique_ptr<socket_type>& socket) {
+basic_session_t::settle(std::uint64_t span) {
+    if (replayable == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(replay_mutex);
+    replayable -= replays.erase(span) + replaying.erase(span);
+}
+
+std::shared_ptr<detail::deadline_t>
+basic_session_t::schedule(std::chrono::milliseconds timeout, std::function<void()> callback) {
+    return scheduler.loop().wheel->schedule(timeout, std::move(callback));
+}
+
+void
+basic_session_t::on_connect(const std::error_code& ec, const protocol_type::endpoint& endpoint, promise<std::error_code> pr, std::unique_ptr<socket_type>& socket) {
     CF_DBG("<< connect: %s", CF_EC(ec));
 
     if (ec) {
-        state = static_cast<std::uint8_t>(state_t::disconnected);
-        transport.synchronize()->reset();
+        on_connect_failed(ec);
     } else {
         CF_CTX_POP();
         CF_CTX("bR");
         CF_DBG(">> listening for read events ...");
 
-        state = static_cast<std::uint8_t>(state_t::connected);
         auto transport = this->transport.synchronize();
-        transport->reset(new transport_type(std::move(socket)));
+        transport->reset(new transport_type(std::move(socket), scheduler.loop().wheel));
+        remote = endpoint;
+        (*transport)->writer->cork(cork_bytes, cork_latency);
+        (*transport)->writer->watermarks(high_watermark, low_watermark);
+
+        // Invocations replayed after the previous connection broke go first, because their spans
+        // were allocated before the ones of frames queued while connecting.
+        std::map<std::uint64_t, frame_t> replayed;
+        {
+            std::lock_guard<std::mutex> lock(replay_mutex);
+            std::swap(replayed, replaying);
+        }
+
+        CF_DBG("replaying %llu messages ...", CF_US(replayed.size()));
+        for (auto& item : replayed) {
+            if (!channels.find(item.first)) {
+                // Revoked while the session was reconnecting.
+                --replayable;
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(replay_mutex);
+                replays.insert(item);
+            }
+
+            auto pusher = std::make_shared<push_t>(std::move(item.second), shared_from_this(), promise<void>());
+            (*pusher)(*transport);
+        }
+
+        // Frames queued while connecting go next, in the order their spans were allocated.
+        CF_DBG("writing %llu queued messages ...", CF_US(backlog.size()));
+        for (auto& item : backlog) {
+            auto pusher = std::make_shared<push_t>(std::move(item.first), shared_from_this(), std::move(item.second));
+            (*pusher)(*transport);
+        }
+        backlog.clear();
+
+        // The state changes under the transport lock, so no frame can be queued after the backlog
+        // is handled.
+        state = static_cast<std::uint8_t>(state_t::connected);
+        quickacked = 0;
         pull(*transport);
     }
 
@@ -263,49 +644,155 @@ basic_session_t::on_connect(const std::error_code& ec, promise<std::error_code>
 }
 
 void
-basic_session_t::on_read(const std::error_code& ec) {
-    CF_DBG("<< read: %s", CF_EC(ec));
+basic_session_t::on_connect_failed(const std::error_code& ec) {
+    // The state changes under the transport lock, so no frame can be queued after the backlog is
+    // taken.
+    decltype(backlog) failed;
+    std::set<std::uint64_t> kept;
 
-    if (ec) {
-        on_error(ec);
-        return;
+    {
+        auto transport = this->transport.synchronize();
+        state = static_cast<std::uint8_t>(state_t::disconnected);
+        transport->reset();
+        std::swap(failed, backlog);
+
+        // Frames of idempotent invocations made while connecting are in the backlog, which fails.
+        // Channels waiting for the replay either wait for the next attempt or fail with the rest.
+        std::lock_guard<std::mutex> lock(replay_mutex);
+        replays.clear();
+        if (!retain_replays_ || closed) {
+            replaying.clear();
+        }
+        replayable = replaying.size();
+
+        for (const auto& item : replaying) {
+            kept.insert(item.first);
+        }
+    }
+
+    for (auto& item : failed) {
+        item.second.set_exception(std::system_error(ec));
     }
 
-    CF_DBG("received message [%llu, %llu, %s]", CF_US(message.span()), CF_US(message.type()), CF_MSG(message.args()).c_str());
-    auto state = channels.apply([&](channel_map_type& channels) -> std::shared_ptr<shared_state_t> {
-         auto it = channels.find(message.span());
-         if (it == channels.end()) {
-             CF_DBG("dropping an orphan span %llu message", CF_US(message.span()));
-             return nullptr;
-         } else {
-             return it->second;
-         }
+    // Channels of invocations made while connecting will never receive anything.
+    const auto drained = kept.empty() ? channels.drain() : channels.drain_except([&](std::uint64_t span) {
+        return kept.count(span) > 0;
     });
 
-    if (state) {
-        state->put(std::move(message));
+    for (const auto& state : drained) {
+        state->put(ec);
+    }
+}
+
+void
+basic_session_t::on_read(const std::error_code& ec, const std::weak_ptr<transport_type>& from) {
+    CF_DBG("<< read: %s", CF_EC(ec));
+
+    // On a decoding error the batch holds the messages decoded before the malformed frame, which
+    // are delivered before the connection is dropped.
+    //
+    // Route the whole batch before delivering it. Messages are delivered outside of the channel
+    // table locks, because setting a value may trigger continuations that revoke channels.
+    for (const auto& message : messages) {
+        CF_DBG("received message [%llu, %llu, %s]", CF_US(message.span()), CF_US(message.type()), CF_MSG(message.args()).c_str());
+        spans.push_back(message.span());
+    }
+
+    channels.find(spans, states);
+
+    for (std::size_t id = 0; id < spans.size(); ++id) {
+        if (!states[id]) {
+            CF_DBG("dropping an orphan span %llu message", CF_US(spans[id]));
+            ++orphans_;
+        }
+
+        // Once the service has responded, replaying the invocation is no longer safe.
+        settle(spans[id]);
+    }
+
+    for (std::size_t id = 0; id < messages.size(); ++id) {
+        if (states[id]) {
+            states[id]->put(std::move(messages[id]));
+        }
+    }
+
+    messages.clear();
+    spans.clear();
+    states.clear();
+
+    if (ec) {
+        on_error(ec, from);
+        return;
     }
 
     auto transport = this->transport.synchronize();
-    if (*transport) {
+    if (*transport && *transport == from.lock()) {
         pull(*transport);
     }
 }
 
 void
-basic_session_t::on_error(const std::error_code& ec) {
+basic_session_t::on_error(const std::error_code& ec, const std::weak_ptr<transport_type>& broken) {
     BOOST_ASSERT(ec);
 
-    state = static_cast<std::uint8_t>(state_t::disconnected);
+    disconnect_handler_type handler;
+    std::vector<std::shared_ptr<shared_state_t>> failed;
 
-    auto channels = this->channels.apply([&](channel_map_type& channels) -> channel_map_type {
-        auto copy = channels;
-        channels.clear();
-        return copy;
-    });
+    {
+        // Invocations neither allocate spans nor queue frames meanwhile, so the ones made after
+        // the connection is dropped are either queued for the next connect or fail at once.
+        std::lock_guard<std::mutex> lock(mutex);
+        auto transport = this->transport.synchronize();
 
-    for (auto channel : channels) {
-        channel.second->put(ec);
+        // Several pending operations may fail with the same broken connection, but only the first
+        // of them drops it. Late failures of previous connections are ignored, unless the session
+        // is closed and its transport has been dropped by the cancellation.
+        const bool current = *transport && *transport == broken.lock();
+        if (!current && !closed) {
+            return;
+        }
+
+        if (current) {
+            int expected(static_cast<int>(state_t::connected));
+            if (!state.compare_exchange_strong(expected, static_cast<int>(state_t::disconnected))) {
+                return;
+            }
+
+            transport->reset();
+            stats.failure(remote);
+
+            if (!closed) {
+                handler = disconnect_handler_;
+            }
+        }
+
+        // Channels of idempotent invocations without responses survive until the next connect,
+        // unless the session is being closed.
+        std::set<std::uint64_t> kept;
+        if (replayable > 0 && !closed) {
+            std::lock_guard<std::mutex> lock(replay_mutex);
+            for (auto& item : replays) {
+                replaying.insert(std::move(item));
+            }
+            replays.clear();
+
+            for (const auto& item : replaying) {
+                kept.insert(item.first);
+            }
+        }
+
+        failed = kept.empty() ? channels.drain() : channels.drain_except([&](std::uint64_t span) {
+            return kept.count(span) > 0;
+        });
+    }
+
+    // Setting values may trigger continuations, which invoke or revoke, so no lock is held.
+    for (const auto& state : failed) {
+        state->put(ec);
+    }
+
+    if (handler) {
+        handler(ec);
     }
 }
 
@@ -313,9 +800,18 @@ void
 basic_session_t::pull(std::shared_ptr<transport_type> transport) {
     CF_DBG(">> listening for read events ...");
 
+    // The kernel falls back to delayed ACKs only after receiving data, so the option is set again
+    // only if the previous read has returned some. It has been set on connect already.
+    const auto received = transport->reader->received();
+    if (received != quickacked && socket_options_.quickack.get_value_or(false) && is_tcp(remote)) {
+        detail::quickack(transport->socket->native_handle());
+    }
+
+    quickacked = received;
+
     transport->reader->read(
-        message,
-        trace::wrap(trace_t::bind(&basic_session_t::on_read, shared_from_this(), ph::_1))
+        messages,
+        trace::wrap(trace_t::bind(&basic_session_t::on_read, shared_from_this(), ph::_1, std::weak_ptr<transport_type>(transport)))
     );
 }
 
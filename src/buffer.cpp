@@ -0,0 +1,111 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/buffer.hpp"
+
+#include <algorithm>
+
+using namespace cocaine::framework::detail;
+
+namespace {
+
+/// Memory kept by a bucket of the pool, which bounds the number of large buffers.
+const std::size_t BUCKET_BYTES = 1 << 24;
+
+/// Bounds of the number of buffers kept by a bucket.
+const std::size_t MIN_BUCKET_CAPACITY = 4;
+const std::size_t MAX_BUCKET_CAPACITY = 64;
+
+/// Returns the largest power of two not greater than the given non-zero size, as its exponent.
+std::size_t
+floor_log2(std::size_t size) noexcept {
+    std::size_t result = 0;
+    while (size >>= 1) {
+        ++result;
+    }
+
+    return result;
+}
+
+/// Returns the smallest power of two not less than the given non-zero size, as its exponent.
+std::size_t
+ceil_log2(std::size_t size) noexcept {
+    const auto result = floor_log2(size);
+    return (std::size_t(1) << result) == size ? result : result + 1;
+}
+
+} // namespace
+
+buffer_pool_t::buffer_pool_t() {
+    for (std::size_t id = 0; id < buckets.size(); ++id) {
+        auto& bucket = buckets[id];
+        bucket.capacity = std::max(MIN_BUCKET_CAPACITY,
+            std::min(MAX_BUCKET_CAPACITY, BUCKET_BYTES >> (min_class + id)));
+
+        // Reserved beforehand, so retiring a buffer never allocates.
+        bucket.buffers.reserve(bucket.capacity);
+    }
+}
+
+buffer_pool_t&
+buffer_pool_t::instance() {
+    // Intentionally leaked, because decoded messages can outlive static objects.
+    static auto pool = new buffer_pool_t;
+    return *pool;
+}
+
+std::shared_ptr<buffer_t>
+buffer_pool_t::acquire(std::size_t size) {
+    // Buffers of the bucket are at least as large as its class, which is less than twice the size,
+    // and smaller than the next class, so they are less than four times larger than requested.
+    const auto cls = std::max<std::size_t>(min_class, ceil_log2(std::max<std::size_t>(size, 1)));
+
+    if (cls <= max_class) {
+        auto& bucket = buckets[cls - min_class];
+        std::lock_guard<std::mutex> lock(bucket.mutex);
+
+        // The most recently retired buffers are the most likely to be unpinned and still cached.
+        for (auto it = bucket.buffers.rbegin(); it != bucket.buffers.rend(); ++it) {
+            if (it->use_count() == 1) {
+                // Pairs with the release decrement of the last message that has pinned the
+                // buffer, so its reads are complete before we overwrite the data.
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                auto buffer = std::move(*it);
+                *it = std::move(bucket.buffers.back());
+                bucket.buffers.pop_back();
+                return buffer;
+            }
+        }
+    }
+
+    // New buffers are rounded up to their class, so they are reused by any request of the class.
+    return std::make_shared<buffer_t>(cls <= max_class ? std::size_t(1) << cls : size);
+}
+
+void
+buffer_pool_t::release(std::shared_ptr<buffer_t> buffer) {
+    const auto cls = floor_log2(buffer->size());
+    if (cls < min_class || cls > max_class) {
+        return;
+    }
+
+    auto& bucket = buckets[cls - min_class];
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+    if (bucket.buffers.size() < bucket.capacity) {
+        bucket.buffers.push_back(std::move(buffer));
+    }
+}
@@ -32,8 +32,173 @@
 
 #include "cocaine/framework/message.hpp"
 
+#include "cocaine/framework/detail/buffer.hpp"
+#include "cocaine/framework/detail/zone.hpp"
+
 using namespace cocaine::framework::detail;
 
+namespace {
+
+/// Reads a big-endian unsigned integer of the given width.
+std::uint64_t
+load(const char* data, size_t width) {
+    std::uint64_t value = 0;
+    for (size_t i = 0; i < width; ++i) {
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    }
+
+    return value;
+}
+
+/// Checks whether the type byte starts an array.
+bool
+is_array(char data) {
+    const auto type = static_cast<unsigned char>(data);
+    return (type >= 0x90 && type <= 0x9f) || type == 0xdc || type == 0xdd;
+}
+
+/// Unpacks the next object of the frame, advancing the offset past it.
+bool
+unpack_next(const char* data, size_t size, size_t& offset, msgpack::zone& zone, msgpack::object& object) {
+    const auto rv = msgpack::unpack(data, size, &offset, &zone, &object);
+    return rv == msgpack::UNPACK_SUCCESS || rv == msgpack::UNPACK_EXTRA_BYTES;
+}
+
+} // namespace
+
+frame_scanner_t::frame_scanner_t(size_t limit) :
+    limit(limit)
+{
+    reset();
+}
+
+size_t frame_scanner_t::scan(const char* data, size_t size, std::error_code& ec) {
+    while (!stack.empty()) {
+        if (offset >= size) {
+            needed_ = 1;
+            return 0;
+        }
+
+        const auto type = static_cast<unsigned char>(data[offset]);
+
+        // Header size, width of the length field following the type byte, raw payload size and
+        // number of nested elements.
+        size_t header = 1;
+        size_t width = 0;
+        std::uint64_t payload = 0;
+        std::uint64_t children = 0;
+
+        if (type <= 0x7f || type >= 0xe0 || type == 0xc0 || type == 0xc2 || type == 0xc3) {
+            // Fixint, nil or boolean.
+        } else if (type <= 0x8f) {
+            children = 2 * (type & 0x0f);
+        } else if (type <= 0x9f) {
+            children = type & 0x0f;
+        } else if (type <= 0xbf) {
+            payload = type & 0x1f;
+        } else {
+            switch (type) {
+            case 0xc4: case 0xd9: width = 1; break;
+            case 0xc5: case 0xda: width = 2; break;
+            case 0xc6: case 0xdb: width = 4; break;
+            case 0xc7: width = 1; header = 2; break;
+            case 0xc8: width = 2; header = 2; break;
+            case 0xc9: width = 4; header = 2; break;
+            case 0xca: payload = 4; break;
+            case 0xcb: payload = 8; break;
+            case 0xcc: case 0xd0: payload = 1; break;
+            case 0xcd: case 0xd1: payload = 2; break;
+            case 0xce: case 0xd2: payload = 4; break;
+            case 0xcf: case 0xd3: payload = 8; break;
+            case 0xd4: payload = 2; break;
+            case 0xd5: payload = 3; break;
+            case 0xd6: payload = 5; break;
+            case 0xd7: payload = 9; break;
+            case 0xd8: payload = 17; break;
+            case 0xdc: width = 2; break;
+            case 0xdd: width = 4; break;
+            case 0xde: width = 2; break;
+            case 0xdf: width = 4; break;
+            default:
+                ec = error::parse_error;
+                return 0;
+            }
+        }
+
+        header += width;
+        if (header > limit - offset) {
+            ec = error::frame_format_error;
+            return 0;
+        }
+
+        if (size - offset < header) {
+            needed_ = header - (size - offset);
+            return 0;
+        }
+
+        if (width > 0) {
+            const auto length = load(data + offset + 1, width);
+
+            switch (type) {
+            case 0xdc: case 0xdd:
+                children = length;
+                break;
+            case 0xde: case 0xdf:
+                children = 2 * length;
+                break;
+            default:
+                payload = length;
+            }
+        }
+
+        if (payload > limit - offset - header) {
+            ec = error::frame_format_error;
+            return 0;
+        }
+
+        if (size - offset - header < payload) {
+            needed_ = payload - (size - offset - header);
+            return 0;
+        }
+
+        offset += header + payload;
+
+        --stack.back();
+        if (children > 0) {
+            // The outermost entry counts the frame itself rather than a container.
+            if (stack.size() > max_depth) {
+                ec = error::frame_format_error;
+                return 0;
+            }
+
+            stack.push_back(children);
+        }
+
+        while (!stack.empty() && stack.back() == 0) {
+            stack.pop_back();
+        }
+    }
+
+    const auto frame = offset;
+    reset();
+    return frame;
+}
+
+void frame_scanner_t::reset() {
+    offset = 0;
+    needed_ = 0;
+    stack.clear();
+    stack.push_back(1);
+}
+
+const size_t decoder_t::max_frame_size;
+
+decoder_t::decoder_t() :
+    zones(std::make_shared<zone_pool_t>()),
+    scanner(max_frame_size),
+    arguments(max_frame_size)
+{}
+
 size_t decoder_t::decode(const char* data, size_t size, message_type& message, std::error_code& ec) {
     size_t offset = 0;
 
@@ -45,17 +210,7 @@ size_t decoder_t::decode(const char* data, size_t size, message_type& message, s
 
     if(rv == msgpack::UNPACK_SUCCESS || rv == msgpack::UNPACK_EXTRA_BYTES) {
         std::vector<hpack::header_t> headers;
-        bool error = false;
-        error = error || object.type != msgpack::type::ARRAY;
-        error = error || object.via.array.size < 3;
-        error = error || object.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER;
-        error = error || object.via.array.ptr[1].type != msgpack::type::POSITIVE_INTEGER;
-        error = error || object.via.array.ptr[2].type != msgpack::type::ARRAY;
-        if(object.via.array.size > 3) {
-            error = error || object.via.array.ptr[3].type != msgpack::type::ARRAY;
-            error = error || !hpack::msgpack_traits::unpack_vector(object.via.array.ptr[3], header_table, headers);
-        }
-        if(error) {
+        if(!validate(object, headers)) {
             ec = error::frame_format_error;
         }
         message = message_type(std::move(object), std::move(zone), std::move(buffer), std::move(headers));
@@ -67,3 +222,115 @@ size_t decoder_t::decode(const char* data, size_t size, message_type& message, s
 
     return offset;
 }
+
+size_t decoder_t::decode(const std::shared_ptr<buffer_t>& buffer, size_t offset, size_t size, message_type& message, std::error_code& ec) {
+    const size_t frame = scanner.scan(buffer->data() + offset, size, ec);
+    if (ec) {
+        return 0;
+    }
+
+    if (frame == 0) {
+        ec = error::insufficient_bytes;
+        return 0;
+    }
+
+    // The frame is known to be complete and well-formed MessagePack here, so only the envelope is
+    // unpacked, while the arguments are left encoded for the receiver.
+    const char* data = buffer->data() + offset;
+    const auto type = static_cast<unsigned char>(data[0]);
+
+    size_t consumed = 0;
+    std::uint64_t count = 0;
+
+    if (type >= 0x90 && type <= 0x9f) {
+        count = type & 0x0f;
+        consumed = 1;
+    } else if (type == 0xdc) {
+        count = load(data + 1, 2);
+        consumed = 3;
+    } else if (type == 0xdd) {
+        count = load(data + 1, 4);
+        consumed = 5;
+    }
+
+    if (count < 3) {
+        ec = error::frame_format_error;
+        return frame;
+    }
+
+    auto zone = zones->acquire();
+
+    msgpack::object span;
+    msgpack::object id;
+
+    bool malformed = false;
+    malformed = malformed || !unpack_next(data, frame, consumed, *zone, span);
+    malformed = malformed || !unpack_next(data, frame, consumed, *zone, id);
+    malformed = malformed || span.type != msgpack::type::POSITIVE_INTEGER;
+    malformed = malformed || id.type != msgpack::type::POSITIVE_INTEGER;
+    malformed = malformed || consumed >= frame || !is_array(data[consumed]);
+
+    const char* args = data + consumed;
+
+    std::vector<hpack::header_t> headers;
+    size_t args_size = 0;
+
+    if (!malformed) {
+        args_size = arguments.scan(args, frame - consumed, ec);
+        consumed += args_size;
+
+        if (count > 3) {
+            msgpack::object meta;
+            malformed = !unpack_next(data, frame, consumed, *zone, meta) || !unpack_headers(meta, headers);
+        }
+    }
+
+    if (malformed) {
+        ec = error::frame_format_error;
+        zones->release(std::move(zone));
+        return frame;
+    }
+
+    // Arguments point directly into the read buffer, so the message must keep it alive.
+    message = message_type(
+        span.via.u64,
+        id.via.u64,
+        args,
+        args_size,
+        std::move(zone),
+        zones,
+        buffer,
+        std::move(headers)
+    );
+
+    return frame;
+}
+
+bool decoder_t::validate(const msgpack::object& object, std::vector<hpack::header_t>& headers) {
+    bool error = false;
+    error = error || object.type != msgpack::type::ARRAY;
+    error = error || object.via.array.size < 3;
+    error = error || object.via.array.ptr[0].type != msgpack::type::POSITIVE_INTEGER;
+    error = error || object.via.array.ptr[1].type != msgpack::type::POSITIVE_INTEGER;
+    error = error || object.via.array.ptr[2].type != msgpack::type::ARRAY;
+    if(!error && object.via.array.size > 3) {
+        error = error || !unpack_headers(object.via.array.ptr[3], headers);
+    }
+
+    return !error;
+}
+
+bool decoder_t::unpack_headers(const msgpack::object& meta, std::vector<hpack::header_t>& headers) {
+    if(meta.type != msgpack::type::ARRAY) {
+        return false;
+    }
+
+    // Headers can not be decoded lazily, because each of them may update the connection-wide
+    // dynamic table, which the following frames refer to. But most frames carry none at all.
+    if(meta.via.array.size > 0) {
+        headers.reserve(meta.via.array.size);
+        return hpack::msgpack_traits::unpack_vector(meta, header_table, headers);
+    }
+
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/encoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+namespace {
+
+/// Memory kept by a bucket of the pool, which bounds the number of large buffers.
+const std::size_t BUCKET_BYTES = 1 << 22;
+
+/// Bounds of the number of buffers kept by a bucket.
+const std::size_t MIN_BUCKET_CAPACITY = 4;
+const std::size_t MAX_BUCKET_CAPACITY = 32;
+
+} // namespace
+
+encode_pool_t::encode_pool_t() {
+    for (std::size_t id = 0; id < buckets.size(); ++id) {
+        auto& bucket = buckets[id];
+        bucket.capacity = std::max(MIN_BUCKET_CAPACITY,
+            std::min(MAX_BUCKET_CAPACITY, BUCKET_BYTES >> (min_class + id)));
+        bucket.buffers.reserve(bucket.capacity);
+    }
+}
+
+encode_pool_t&
+encode_pool_t::instance() {
+    // Intentionally leaked, because frames can outlive static objects, holding their buffers
+    // while the process exits.
+    static auto pool = new encode_pool_t;
+    return *pool;
+}
+
+std::shared_ptr<encode_pool_t::buffer_type>
+encode_pool_t::acquire(std::size_t size) {
+    std::size_t cls = min_class;
+    while (cls <= max_class && (std::size_t(1) << cls) < size) {
+        ++cls;
+    }
+
+    if (cls > max_class) {
+        return std::make_shared<buffer_type>(size);
+    }
+
+    auto& bucket = buckets[cls - min_class];
+    std::lock_guard<std::mutex> lock(bucket.mutex);
+
+    // The most recently added buffers are checked first, they are likely to be hot.
+    for (auto it = bucket.buffers.rbegin(); it != bucket.buffers.rend(); ++it) {
+        if (it->use_count() == 1) {
+            // Pairs with the release decrement of the frame that has been written last, so the
+            // writer is done with the data before we overwrite it.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return *it;
+        }
+    }
+
+    // The buffer and its reference counter are allocated at once and kept for good, unless the
+    // bucket is full.
+    auto buffer = std::make_shared<buffer_type>(std::size_t(1) << cls);
+    if (bucket.buffers.size() < bucket.capacity) {
+        bucket.buffers.push_back(buffer);
+    }
+
+    return buffer;
+}
@@ -73,6 +73,7 @@ public:
     scheduler_t scheduler;
 
     service_manager_t::shutdown_policy_t shutdown_policy;
+    socket_options_t socket_options;
 
     std::vector<session_t::endpoint_type> locations;
 
@@ -198,3 +199,17 @@ void
 service_manager_t::shutdown_policy(shutdown_policy_t policy) {
     d->shutdown_policy = policy;
 }
+
+const socket_options_t&
+service_manager_t::socket_options() const {
+    return d->socket_options;
+}
+
+void
+service_manager_t::socket_options(socket_options_t options) {
+    d->socket_options = std::move(options);
+
+    if (d->logger) {
+        d->logger->socket_options(d->socket_options);
+    }
+}
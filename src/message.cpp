@@ -17,6 +17,7 @@
 #include "cocaine/framework/message.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <type_traits>
 #include <vector>
 
@@ -27,55 +28,209 @@
 
 #include <cocaine/hpack/header.hpp>
 
+#include "cocaine/framework/detail/buffer.hpp"
+#include "cocaine/framework/detail/zone.hpp"
+
 using namespace cocaine::framework;
 
-class decoded_message::inner_t {
-public:
-    inner_t() {}
+namespace {
+
+/// Extracts the envelope fields of the given message object, leaving them intact if the object is
+/// malformed.
+void
+envelope(const msgpack::object& obj, std::uint64_t& span, std::uint64_t& type, msgpack::object& args) {
+    if (obj.type != msgpack::type::ARRAY || obj.via.array.size < 3) {
+        return;
+    }
+
+    const msgpack::object* ptr = obj.via.array.ptr;
+    if (ptr[0].type == msgpack::type::POSITIVE_INTEGER && ptr[1].type == msgpack::type::POSITIVE_INTEGER) {
+        span = ptr[0].via.u64;
+        type = ptr[1].via.u64;
+        args = ptr[2];
+    }
+}
+
+/// Orders header names by their size first, then by their bytes.
+bool
+less(const hpack::header::data_t& lhs, const hpack::header::data_t& rhs) {
+    if (lhs.size != rhs.size) {
+        return lhs.size < rhs.size;
+    }
 
-    inner_t(msgpack::object _obj, std::unique_ptr<msgpack::zone> zone, std::vector<char>&& _storage, hpack::header_storage_t _headers) :
-        obj(std::move(_obj)),
-        zone(std::move(zone)),
-        storage(std::move(_storage)),
-        headers(std::move(_headers))
-    {}
+    return std::memcmp(lhs.blob, rhs.blob, lhs.size) < 0;
+}
 
-    msgpack::object obj;
-    std::unique_ptr<msgpack::zone> zone;
-    std::vector<char> storage;
-    hpack::header_storage_t headers;
-};
+} // namespace
 
 decoded_message::decoded_message(boost::none_t) :
-    d(new inner_t)
+    span_(0),
+    type_(0),
+    raw(nullptr),
+    raw_size(0),
+    unpacked(true),
+    indexed(false)
 {}
 
 decoded_message::decoded_message(msgpack::object obj, std::vector<char>&& storage, std::vector<hpack::header_t> headers) :
-    d(new inner_t(std::move(obj), std::unique_ptr<msgpack::zone>(new msgpack::zone{}), std::move(storage), std::move(headers)))
-{}
+    span_(0),
+    type_(0),
+    raw(nullptr),
+    raw_size(0),
+    unpacked(true),
+    zone(new msgpack::zone{}),
+    storage(std::move(storage)),
+    headers(std::move(headers)),
+    indexed(false)
+{
+    envelope(obj, span_, type_, args_);
+}
 
 decoded_message::decoded_message(msgpack::object obj, std::unique_ptr<msgpack::zone> zone, std::vector<char> storage, std::vector<hpack::header_t> headers) :
-    d(new inner_t(std::move(obj), std::move(zone), std::move(storage), std::move(headers)))
+    span_(0),
+    type_(0),
+    raw(nullptr),
+    raw_size(0),
+    unpacked(true),
+    zone(std::move(zone)),
+    storage(std::move(storage)),
+    headers(std::move(headers)),
+    indexed(false)
+{
+    envelope(obj, span_, type_, args_);
+}
+
+decoded_message::decoded_message(std::uint64_t span, std::uint64_t type, const char* args, std::size_t size, std::unique_ptr<msgpack::zone> zone, std::shared_ptr<detail::zone_pool_t> pool, std::shared_ptr<const detail::buffer_t> storage, std::vector<hpack::header_t> headers) :
+    span_(span),
+    type_(type),
+    raw(args),
+    raw_size(size),
+    unpacked(false),
+    zone(std::move(zone)),
+    pool(std::move(pool)),
+    buffer(std::move(storage)),
+    headers(std::move(headers)),
+    indexed(false)
 {}
 
-decoded_message::~decoded_message() = default;
+decoded_message::~decoded_message() {
+    if (pool && zone) {
+        pool->release(std::move(zone));
+    }
+}
 
-decoded_message::decoded_message(decoded_message&& other) = default;
+decoded_message::decoded_message(decoded_message&& other) noexcept :
+    span_(other.span_),
+    type_(other.type_),
+    raw(other.raw),
+    raw_size(other.raw_size),
+    args_(other.args_),
+    unpacked(other.unpacked),
+    zone(std::move(other.zone)),
+    pool(std::move(other.pool)),
+    storage(std::move(other.storage)),
+    buffer(std::move(other.buffer)),
+    headers(std::move(other.headers)),
+    index(std::move(other.index)),
+    indexed(other.indexed)
+{
+    other.reset();
+}
 
-auto decoded_message::operator=(decoded_message&& other) -> decoded_message& = default;
+auto decoded_message::operator=(decoded_message&& other) -> decoded_message& {
+    if (this != &other) {
+        // Return the current zone to its pool instead of freeing it.
+        if (pool && zone) {
+            pool->release(std::move(zone));
+        }
+
+        span_ = other.span_;
+        type_ = other.type_;
+        raw = other.raw;
+        raw_size = other.raw_size;
+        args_ = other.args_;
+        unpacked = other.unpacked;
+        zone = std::move(other.zone);
+        pool = std::move(other.pool);
+        storage = std::move(other.storage);
+        buffer = std::move(other.buffer);
+        headers = std::move(other.headers);
+        index = std::move(other.index);
+        indexed = other.indexed;
+
+        other.reset();
+    }
+
+    return *this;
+}
 
 auto decoded_message::span() const -> uint64_t {
-    return d->obj.via.array.ptr[0].as<uint64_t>();
+    return span_;
 }
 
 auto decoded_message::type() const -> uint64_t {
-    return d->obj.via.array.ptr[1].as<uint64_t>();
+    return type_;
 }
 
 auto decoded_message::args() const -> const msgpack::object& {
-    return d->obj.via.array.ptr[2];
+    if (!unpacked) {
+        // The decoder has already checked that the arguments are a complete array.
+        std::size_t offset = 0;
+        msgpack::unpack(raw, raw_size, &offset, zone.get(), &args_);
+        unpacked = true;
+    }
+
+    return args_;
+}
+
+auto decoded_message::raw_args() const noexcept -> std::pair<const char*, std::size_t> {
+    return std::make_pair(raw, raw_size);
 }
 
 auto decoded_message::meta() const noexcept -> const std::vector<hpack::header_t>& {
-    return d->headers;
+    return headers;
+}
+
+auto decoded_message::find_header(const hpack::header::data_t& name) const -> boost::optional<hpack::header_t> {
+    const std::vector<hpack::header_t>& headers = meta();
+
+    if (!indexed) {
+        index.resize(headers.size());
+        for (std::size_t id = 0; id < headers.size(); ++id) {
+            index[id] = id;
+        }
+
+        // The stable sort keeps the headers with the same name in order, so the first of them is
+        // the one kept.
+        std::stable_sort(index.begin(), index.end(), [&](std::size_t lhs, std::size_t rhs) {
+            return less(headers[lhs].name(), headers[rhs].name());
+        });
+
+        index.erase(std::unique(index.begin(), index.end(), [&](std::size_t lhs, std::size_t rhs) {
+            return headers[lhs].name() == headers[rhs].name();
+        }), index.end());
+
+        indexed = true;
+    }
+
+    const auto it = std::lower_bound(index.begin(), index.end(), name, [&](std::size_t id, const hpack::header::data_t& name) {
+        return less(headers[id].name(), name);
+    });
+
+    if (it == index.end() || !(headers[*it].name() == name)) {
+        return boost::none;
+    }
+
+    return headers[*it];
+}
+
+auto decoded_message::reset() noexcept -> void {
+    span_ = 0;
+    type_ = 0;
+    raw = nullptr;
+    raw_size = 0;
+    args_ = msgpack::object();
+    unpacked = true;
+    index.clear();
+    indexed = false;
 }
@@ -16,8 +16,14 @@
 
 #include "cocaine/framework/detail/net.hpp"
 
+#include <cerrno>
+#include <cstring>
 #include <stdexcept>
 
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
 #include <boost/version.hpp>
 
 #if BOOST_VERSION < 104800
@@ -73,4 +79,85 @@ endpoint_cast(const boost::asio::ip::tcp::endpoint& endpoint) {
     return { address_cast(endpoint.address()), endpoint.port() };
 }
 
+asio::local::stream_protocol::endpoint
+endpoint_cast(const boost::asio::local::stream_protocol::endpoint& endpoint) {
+    return { endpoint.path() };
+}
+
+bool
+is_tcp(const asio::generic::stream_protocol::endpoint& endpoint) {
+    const auto family = endpoint.protocol().family();
+    return family == AF_INET || family == AF_INET6;
+}
+
+asio::ip::tcp::endpoint
+tcp_cast(const asio::generic::stream_protocol::endpoint& endpoint) {
+    asio::ip::tcp::endpoint result;
+    std::memcpy(result.data(), endpoint.data(), endpoint.size());
+    result.resize(endpoint.size());
+    return result;
+}
+
+namespace {
+
+void
+set(int fd, int level, int name, int value, std::error_code& ec) {
+    if (::setsockopt(fd, level, name, &value, sizeof(value)) != 0 && !ec) {
+        ec = std::error_code(errno, std::system_category());
+    }
+}
+
+} // namespace
+
+std::error_code
+apply(int fd, const socket_options_t& options, bool tcp) {
+    std::error_code ec;
+
+    if (options.send_buffer) {
+        set(fd, SOL_SOCKET, SO_SNDBUF, *options.send_buffer, ec);
+    }
+
+    if (options.receive_buffer) {
+        set(fd, SOL_SOCKET, SO_RCVBUF, *options.receive_buffer, ec);
+    }
+
+#ifdef SO_BUSY_POLL
+    if (options.busy_poll) {
+        set(fd, SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.busy_poll->count()), ec);
+    }
+#endif
+
+    if (!tcp) {
+        return ec;
+    }
+
+    if (options.nodelay) {
+        set(fd, IPPROTO_TCP, TCP_NODELAY, *options.nodelay ? 1 : 0, ec);
+    }
+
+#ifdef TCP_QUICKACK
+    if (options.quickack) {
+        set(fd, IPPROTO_TCP, TCP_QUICKACK, *options.quickack ? 1 : 0, ec);
+    }
+#endif
+
+#ifdef TCP_USER_TIMEOUT
+    if (options.user_timeout) {
+        set(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, static_cast<int>(options.user_timeout->count()), ec);
+    }
+#endif
+
+    return ec;
+}
+
+void
+quickack(int fd) {
+#ifdef TCP_QUICKACK
+    const int value = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &value, sizeof(value));
+#else
+    (void)fd;
+#endif
+}
+
 }}} // namespace cocaine::framework::detail
@@ -16,30 +16,123 @@
 
 #include "cocaine/framework/receiver.hpp"
 
+#include <limits>
+
+#include <asio/error.hpp>
+
 #include "cocaine/framework/detail/shared_state.hpp"
 #include "cocaine/framework/detail/log.hpp"
+#include "cocaine/framework/detail/timer_wheel.hpp"
 
 using namespace cocaine::framework;
 
+namespace {
+
+/// Fails the channel with the timed out error and revokes it, unless the message with the given
+/// ticket has already been received.
+template<class Session>
+void
+on_expire(std::weak_ptr<Session> session, std::uint64_t id, std::weak_ptr<shared_state_t> state, std::uint64_t ticket) {
+    auto state_ = state.lock();
+    if (!state_ || !state_->expire(asio::error::timed_out, ticket)) {
+        return;
+    }
+
+    CF_DBG("<< channel %llu deadline has expired", CF_US(id));
+
+    if (auto session_ = session.lock()) {
+        session_->revoke(id);
+    }
+}
+
+} // namespace
+
 template<class Session>
 basic_receiver_t<Session>::basic_receiver_t(std::uint64_t id, std::shared_ptr<Session> session, std::shared_ptr<shared_state_t> state) :
     id(id),
     session(std::move(session)),
-    state(std::move(state))
+    state(std::move(state)),
+    cancel_abandoned(false),
+    finished(false),
+    cancelled(false)
 {}
 
 template<class Session>
 basic_receiver_t<Session>::~basic_receiver_t() {
+    if (cancel_abandoned && !finished && !cancelled) {
+        CF_DBG("cancelling abandoned channel %llu ...", CF_US(id));
+        cancel();
+        return;
+    }
+
     CF_DBG("revoking ...");
     session->revoke(id);
 }
 
+template<class Session>
+void
+basic_receiver_t<Session>::cancellable(canceller_type canceller, bool abandoned) {
+    this->canceller = std::move(canceller);
+    cancel_abandoned = abandoned;
+}
+
+template<class Session>
+void
+basic_receiver_t<Session>::finish() {
+    finished = true;
+}
+
+template<class Session>
+task<void>::future_type
+basic_receiver_t<Session>::cancel() {
+    if (cancelled.exchange(true)) {
+        return make_ready_future<void>::value();
+    }
+
+    CF_DBG(">> cancelling channel %llu", CF_US(id));
+
+    // Messages the service sends until it handles the cancellation are dropped as orphans.
+    auto future = canceller && !finished
+        ? canceller()
+        : make_ready_future<void>::value();
+
+    state->put(asio::error::operation_aborted);
+    session->revoke(id);
+
+    return future;
+}
+
+template<class Session>
+void
+basic_receiver_t<Session>::deadline(std::chrono::milliseconds timeout) {
+    deadline_ = session->schedule(timeout, std::bind(
+        &on_expire<Session>, std::weak_ptr<Session>(session), id, std::weak_ptr<shared_state_t>(state),
+        std::numeric_limits<std::uint64_t>::max()
+    ));
+}
+
 template<class Session>
 task<decoded_message>::future_type
 basic_receiver_t<Session>::recv() {
     return state->get();
 }
 
+template<class Session>
+task<decoded_message>::future_type
+basic_receiver_t<Session>::recv_for(std::chrono::milliseconds timeout) {
+    std::uint64_t ticket;
+    auto future = state->get(ticket);
+
+    auto deadline = session->schedule(timeout, std::bind(
+        &on_expire<Session>, std::weak_ptr<Session>(session), id, std::weak_ptr<shared_state_t>(state), ticket
+    ));
+
+    return future.then([deadline](task<decoded_message>::future_move_type future) -> decoded_message {
+        deadline->cancel();
+        return future.get();
+    });
+}
+
 template<class Session>
 cocaine::trace_t
 basic_receiver_t<Session>::get_trace() const {
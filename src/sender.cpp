@@ -14,6 +14,10 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <system_error>
+
+#include <asio/error.hpp>
+
 #include <cocaine/common.hpp>
 
 #include "cocaine/framework/sender.hpp"
@@ -26,11 +30,18 @@ using namespace cocaine::framework;
 template<class Session>
 basic_sender_t<Session>::basic_sender_t(std::uint64_t id, std::shared_ptr<session_type> session) :
     id(id),
-    session(std::move(session))
+    session(std::move(session)),
+    closed(false)
 {}
 
 template<class Session>
 task<void>::future_type
-basic_sender_t<Session>::send(io::encoder_t::message_type&& message) {
-    return session->push(std::move(message));
+basic_sender_t<Session>::send(frame_t&& frame, bool terminal) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (closed) {
+        return make_ready_future<void>::error(std::system_error(asio::error::operation_aborted));
+    }
+
+    closed = terminal;
+    return session->push(std::move(frame));
 }
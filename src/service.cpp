@@ -16,8 +16,18 @@
 
 #include "cocaine/framework/service.hpp"
 
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <asio/error.hpp>
+
+#include <cocaine/locked_ptr.hpp>
+
 #include "cocaine/framework/detail/basic_session.hpp"
 #include "cocaine/framework/detail/log.hpp"
+#include "cocaine/framework/detail/loop.hpp"
 #include "cocaine/framework/detail/resolver.hpp"
 #include "cocaine/framework/trace.hpp"
 
@@ -49,6 +59,243 @@ on_connect(task<void>::future_move_type future) {
     }
 }
 
+/// Completes the promise after all of the given number of connects succeed or the first of them
+/// fails.
+class join_t {
+    std::mutex mutex;
+    std::size_t pending;
+    bool done;
+    task<void>::promise_type promise;
+
+public:
+    explicit
+    join_t(std::size_t pending) :
+        pending(pending),
+        done(false)
+    {}
+
+    task<void>::future_type
+    get_future() {
+        return promise.get_future();
+    }
+
+    void
+    on_connect(task<void>::future_move_type future) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (done) {
+            return;
+        }
+
+        try {
+            future.get();
+        } catch (...) {
+            done = true;
+            promise.set_exception(std::current_exception());
+            return;
+        }
+
+        if (--pending == 0) {
+            done = true;
+            promise.set_value();
+        }
+    }
+};
+
+/// Reconnects the session through the Locator in the background, waiting for a jittered
+/// exponentially growing delay between failed attempts.
+///
+/// Once enabled, all connects of the session go through it: the ones requested while an attempt is
+/// scheduled or in progress join it instead of hitting the Locator on their own, so a crowd of
+/// callers, which have lost the connection at once, results in a single attempt.
+class reconnect_t:
+    public std::enable_shared_from_this<reconnect_t>
+{
+    typedef std::shared_ptr<task<void>::promise_type> promise_type;
+
+    const std::weak_ptr<session_t> session;
+    const std::string name;
+    const uint version;
+    const std::shared_ptr<serialized_resolver_t> resolver;
+    scheduler_t& scheduler;
+
+    std::mutex mutex;
+
+    /// Backoff bounds, zero initial delay disables reconnecting.
+    std::chrono::milliseconds initial_delay;
+    std::chrono::milliseconds max_delay;
+
+    /// Number of failed attempts in a row.
+    std::size_t failures;
+    /// Whether an attempt is scheduled or in progress.
+    bool pending;
+    std::shared_ptr<detail::deadline_t> deadline;
+    std::vector<promise_type> waiters;
+
+    std::mt19937 random;
+
+public:
+    reconnect_t(std::weak_ptr<session_t> session,
+                std::string name,
+                uint version,
+                std::shared_ptr<serialized_resolver_t> resolver,
+                scheduler_t& scheduler) :
+        session(std::move(session)),
+        name(std::move(name)),
+        version(version),
+        resolver(std::move(resolver)),
+        scheduler(scheduler),
+        initial_delay(0),
+        max_delay(0),
+        failures(0),
+        pending(false),
+        random(std::random_device()())
+    {}
+
+    /// Sets the backoff bounds.
+    ///
+    /// Channels waiting for the replay are retained across failed attempts while reconnecting is
+    /// enabled, and fail once it is disabled.
+    void
+    backoff(std::chrono::milliseconds initial, std::chrono::milliseconds max) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            initial_delay = initial;
+            max_delay = std::max(initial, max);
+        }
+
+        if (auto session = this->session.lock()) {
+            session->retain_replays(initial.count() > 0);
+            if (initial.count() == 0) {
+                session->abandon_replays(asio::error::operation_aborted);
+            }
+        }
+    }
+
+    bool
+    enabled() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return initial_delay.count() > 0;
+    }
+
+    /// Joins the pending attempt or starts a new one immediately.
+    task<void>::future_type
+    connect() {
+        auto promise = std::make_shared<task<void>::promise_type>();
+        auto future = promise->get_future();
+
+        bool start = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            waiters.push_back(std::move(promise));
+            if (!pending) {
+                pending = true;
+                start = true;
+            }
+        }
+
+        if (start) {
+            attempt();
+        }
+
+        return future;
+    }
+
+    /// Schedules an attempt after the established connection breaks.
+    void
+    on_disconnect(const std::error_code& ec) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (initial_delay.count() == 0 || pending) {
+            return;
+        }
+
+        CF_DBG("connection to '%s' is broken: %s, reconnecting ...", name.c_str(), CF_EC(ec));
+
+        pending = true;
+        schedule();
+    }
+
+private:
+    /// \pre the mutex is locked.
+    void
+    schedule() {
+        // The delay doubles with each failure up to the upper bound, and is randomized between
+        // its half and its whole, so clients disconnected at once come back spread in time.
+        auto base = initial_delay;
+        for (std::size_t id = 0; id < failures && base < max_delay; ++id) {
+            base *= 2;
+        }
+        base = std::min(base, max_delay);
+
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> distribution(base.count() / 2, base.count());
+        const std::chrono::milliseconds delay(distribution(random));
+
+        CF_DBG("reconnecting to '%s' in %lld ms", name.c_str(), static_cast<long long>(delay.count()));
+
+        std::weak_ptr<reconnect_t> self(shared_from_this());
+        deadline = scheduler.loop().wheel->schedule(delay, [self] {
+            if (auto reconnect = self.lock()) {
+                reconnect->attempt();
+            }
+        });
+    }
+
+    void
+    attempt() {
+        auto session = this->session.lock();
+        if (!session) {
+            return;
+        }
+
+        if (session->connected()) {
+            auto future = make_ready_future<void>::value();
+            on_connect(future);
+            return;
+        }
+
+        resolver->resolve(name)
+            .then(trace::wrap(trace_t::bind(&::on_resolve, ph::_1, version, session)))
+            .then(trace::wrap(trace_t::bind(&reconnect_t::on_connect, shared_from_this(), ph::_1)));
+    }
+
+    void
+    on_connect(task<void>::future_move_type future) {
+        std::exception_ptr error;
+        try {
+            future.get();
+            CF_DBG("<< reconnected to '%s'", name.c_str());
+        } catch (const std::exception& err) {
+            CF_DBG("<< failed to reconnect to '%s': %s", name.c_str(), err.what());
+            error = std::current_exception();
+        }
+
+        std::vector<promise_type> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(waiters, this->waiters);
+
+            if (!error) {
+                failures = 0;
+            }
+
+            if (error && initial_delay.count() > 0) {
+                // Waiters fail now, the next attempt is made in the background.
+                ++failures;
+                schedule();
+            } else {
+                pending = false;
+            }
+        }
+
+        for (auto& waiter : waiters) {
+            if (error) {
+                waiter->set_exception(error);
+            } else {
+                waiter->set_value();
+            }
+        }
+    }
+};
+
 } // namespace
 
 class basic_service_t::impl {
@@ -59,24 +306,81 @@ public:
     std::shared_ptr<serialized_resolver_t> resolver;
     std::mutex mutex;
 
+    /// Connection settings, which are also applied to connections added later.
+    std::size_t cork_bytes;
+    std::chrono::microseconds cork_latency;
+    std::size_t high_watermark;
+    std::size_t low_watermark;
+    bool cancel_abandoned;
+    bool replay;
+    socket_options_t socket_options;
+    std::chrono::milliseconds backoff_initial;
+    std::chrono::milliseconds backoff_max;
+
+    /// Background reconnectors of the service connections.
+    std::map<const session_t*, std::shared_ptr<reconnect_t>> reconnects;
+
+    typedef std::vector<std::shared_ptr<session_t>> sessions_type;
+
+    /// Connections to the service, there is always at least one.
+    ///
+    /// The vector is never modified in place, resizing publishes a new one. So invocations iterate
+    /// their own snapshot without holding any lock.
+    synchronized<std::shared_ptr<const sessions_type>> sessions;
+
     impl(std::string name, uint version, endpoints_t locations, scheduler_t& scheduler) :
         name(std::move(name)),
         version(version),
         scheduler(scheduler),
-        resolver(std::make_shared<serialized_resolver_t>(std::move(locations), scheduler))
+        resolver(std::make_shared<serialized_resolver_t>(std::move(locations), scheduler)),
+        cork_bytes(0),
+        cork_latency(0),
+        high_watermark(0),
+        low_watermark(0),
+        cancel_abandoned(false),
+        replay(false),
+        backoff_initial(0),
+        backoff_max(0),
+        sessions(std::make_shared<const sessions_type>())
     {}
+
+    /// Returns the current connections snapshot.
+    std::shared_ptr<const sessions_type>
+    snapshot() const {
+        return *sessions.synchronize();
+    }
+
+    /// Attaches the background reconnector to the given session.
+    void
+    attach(const std::shared_ptr<session_t>& session) {
+        auto reconnect = std::make_shared<reconnect_t>(session, name, version, resolver, scheduler);
+        reconnect->backoff(backoff_initial, backoff_max);
+
+        std::weak_ptr<reconnect_t> weak(reconnect);
+        session->disconnect_handler([weak](const std::error_code& ec) {
+            if (auto reconnect = weak.lock()) {
+                reconnect->on_disconnect(ec);
+            }
+        });
+
+        reconnects[session.get()] = std::move(reconnect);
+    }
 };
 
 basic_service_t::basic_service_t(internal_logger_t logger_, std::string name, uint version, endpoints_t locations, scheduler_t& scheduler) :
     d(new impl(std::move(name), version, std::move(locations), scheduler)),
-    session(std::make_shared<session_t>(scheduler)),
+    counter(0),
     scheduler(scheduler),
     logger(std::move(logger_))
-{}
+{
+    auto session = std::make_shared<session_t>(scheduler);
+    d->attach(session);
+    *d->sessions.synchronize() = std::make_shared<const impl::sessions_type>(1, std::move(session));
+}
 
 basic_service_t::basic_service_t(basic_service_t&& other) :
     d(std::move(other.d)),
-    session(std::move(other.session)),
+    counter(other.counter.load()),
     scheduler(other.scheduler),
     logger(std::move(other.logger))
 {}
@@ -94,11 +398,136 @@ basic_service_t::version() const noexcept {
 }
 
 auto basic_service_t::hard_shutdown(bool policy) -> void {
-    session->hard_shutdown(policy);
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->hard_shutdown(policy);
+    }
+}
+
+auto basic_service_t::connections(std::size_t count) -> void {
+    count = std::max<std::size_t>(count, 1);
+
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    auto sessions = *d->snapshot();
+    while (sessions.size() > count) {
+        d->reconnects.erase(sessions.back().get());
+        sessions.pop_back();
+    }
+
+    while (sessions.size() < count) {
+        auto session = std::make_shared<session_t>(scheduler);
+        session->cork(d->cork_bytes, d->cork_latency);
+        session->watermarks(d->high_watermark, d->low_watermark);
+        session->cancel_abandoned(d->cancel_abandoned);
+        session->replay(d->replay);
+        session->socket_options(d->socket_options);
+        d->attach(session);
+        sessions.push_back(std::move(session));
+    }
+
+    *d->sessions.synchronize() = std::make_shared<const impl::sessions_type>(std::move(sessions));
+}
+
+auto basic_service_t::cork(std::size_t bytes, std::chrono::microseconds latency) -> void {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->cork_bytes = bytes;
+    d->cork_latency = latency;
+
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->cork(bytes, latency);
+    }
+}
+
+auto basic_service_t::watermarks(std::size_t high, std::size_t low) -> void {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->high_watermark = high;
+    d->low_watermark = low;
+
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->watermarks(high, low);
+    }
+}
+
+auto basic_service_t::socket_options(const socket_options_t& options) -> void {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->socket_options = options;
+
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->socket_options(options);
+    }
+}
+
+auto basic_service_t::cancel_abandoned(bool policy) -> void {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->cancel_abandoned = policy;
+
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->cancel_abandoned(policy);
+    }
+}
+
+auto basic_service_t::replay(bool policy) -> void {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->replay = policy;
+
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        session->replay(policy);
+    }
+}
+
+auto basic_service_t::reconnect(std::chrono::milliseconds initial, std::chrono::milliseconds max) -> void {
+    // Changing the backoff may abandon the channels waiting for the replay, which completes their
+    // states, so it is done after unlocking.
+    std::vector<std::shared_ptr<reconnect_t>> reconnects;
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        d->backoff_initial = initial;
+        d->backoff_max = max;
+
+        for (const auto& reconnect : d->reconnects) {
+            reconnects.push_back(reconnect.second);
+        }
+    }
+
+    for (const auto& reconnect : reconnects) {
+        reconnect->backoff(initial, max);
+    }
+}
+
+std::uint64_t
+basic_service_t::orphans() const {
+    std::uint64_t result = 0;
+    const auto sessions = d->snapshot();
+    for (const auto& session : *sessions) {
+        result += session->orphans();
+    }
+
+    return result;
 }
 
 cocaine::framework::future<void>
 basic_service_t::connect() {
+    const auto sessions = d->snapshot();
+    if (sessions->size() == 1) {
+        return connect(sessions->front());
+    }
+
+    auto join = std::make_shared<join_t>(sessions->size());
+    for (const auto& session : *sessions) {
+        connect(session).then(trace::wrap(trace_t::bind(&join_t::on_connect, join, ph::_1)));
+    }
+
+    return join->get_future();
+}
+
+cocaine::framework::future<void>
+basic_service_t::connect(std::shared_ptr<session_t> session) {
     CF_CTX("SC");
     CF_DBG(">> connecting ...");
 
@@ -111,17 +540,44 @@ basic_service_t::connect() {
         return make_ready_future<void>::value();
     }
 
+    auto it = d->reconnects.find(session.get());
+    if (it != d->reconnects.end() && it->second->enabled()) {
+        return it->second->connect();
+    }
+
     return d->resolver->resolve(d->name)
         .then(trace::wrap(trace_t::bind(&::on_resolve, ph::_1, d->version, session)))
         .then(trace::wrap(trace_t::bind(&::on_connect, ph::_1)));
 }
 
+std::shared_ptr<session_t>
+basic_service_t::select() {
+    // Ties are broken by scanning from a rotating offset, so idle connections share the load too.
+    const auto snapshot = d->snapshot();
+    const auto& sessions = *snapshot;
+    const auto size = sessions.size();
+    const auto offset = size == 1 ? 0 : counter++ % size;
+
+    auto result = &sessions[offset];
+    auto load = (*result)->load();
+    for (std::size_t id = 1; id < size && load > 0; ++id) {
+        auto& session = sessions[(offset + id) % size];
+        const auto current = session->load();
+        if (current < load) {
+            result = &session;
+            load = current;
+        }
+    }
+
+    return *result;
+}
+
 boost::optional<session_t::endpoint_type>
 basic_service_t::endpoint() const {
-    return session->endpoint();
+    return d->snapshot()->front()->endpoint();
 }
 
 basic_service_t::native_handle_type
 basic_service_t::native_handle() const {
-    return session->native_handle();
+    return d->snapshot()->front()->native_handle();
 }
@@ -98,6 +98,16 @@ bool session<BasicSession>::connected() const {
     return d->sess->connected();
 }
 
+template<class BasicSession>
+bool session<BasicSession>::connecting() const {
+    return d->sess->connecting();
+}
+
+template<class BasicSession>
+std::size_t session<BasicSession>::load() const {
+    return d->sess->load();
+}
+
 template<class BasicSession>
 auto session<BasicSession>::connect(const session::endpoint_type& endpoint) -> task<void>::future_type {
     return connect(std::vector<endpoint_type> {{ endpoint }});
@@ -120,11 +130,72 @@ auto session<BasicSession>::connect(const std::vector<session::endpoint_type>& e
     return future;
 }
 
+template<class BasicSession>
+auto session<BasicSession>::connect(const session::local_endpoint_type& endpoint) -> task<void>::future_type {
+    auto promise = std::make_shared<task<void>::promise_type>();
+    auto future = promise->get_future();
+
+    d->sess->connect(endpoint)
+        .then(d->scheduler, trace::wrap(trace_t::bind(&impl::on_connect, d, ph::_1, promise)));
+
+    return future;
+}
+
 template<class BasicSession>
 auto session<BasicSession>::hard_shutdown(bool policy) -> void {
     d->sess->hard_shutdown(policy);
 }
 
+template<class BasicSession>
+auto session<BasicSession>::cancel_abandoned(bool policy) -> void {
+    d->sess->cancel_abandoned(policy);
+}
+
+template<class BasicSession>
+std::uint64_t session<BasicSession>::orphans() const {
+    return d->sess->orphans();
+}
+
+template<class BasicSession>
+auto session<BasicSession>::replay(bool policy) -> void {
+    d->sess->replay(policy);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::retain_replays(bool policy) -> void {
+    d->sess->retain_replays(policy);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::abandon_replays(const std::error_code& ec) -> void {
+    d->sess->abandon_replays(ec);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::disconnect_handler(std::function<void(const std::error_code&)> handler) -> void {
+    d->sess->disconnect_handler(std::move(handler));
+}
+
+template<class BasicSession>
+auto session<BasicSession>::cork(std::size_t bytes, std::chrono::microseconds latency) -> void {
+    d->sess->cork(bytes, latency);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::socket_options(const socket_options_t& options) -> void {
+    d->sess->socket_options(options);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::watermarks(std::size_t high, std::size_t low) -> void {
+    d->sess->watermarks(high, low);
+}
+
+template<class BasicSession>
+auto session<BasicSession>::writable() -> task<void>::future_type {
+    return d->sess->writable();
+}
+
 template<class BasicSession>
 auto session<BasicSession>::endpoint() const -> boost::optional<endpoint_type> {
     return d->sess->endpoint();
@@ -137,10 +208,22 @@ session<BasicSession>::native_handle() const {
 }
 
 template<class BasicSession>
-auto session<BasicSession>::invoke(encode_callback_t encode_callback)
+auto session<BasicSession>::invoke(encode_callback_t encode_callback, std::chrono::milliseconds timeout, bool idempotent)
     -> task<basic_invoke_result>::future_type
 {
-    return d->sess->invoke(std::move(encode_callback));
+    return d->sess->invoke(std::move(encode_callback), timeout, idempotent);
+}
+
+template<class BasicSession>
+bool session<BasicSession>::cancels_abandoned() const {
+    return d->sess->cancels_abandoned();
+}
+
+template<class BasicSession>
+auto session<BasicSession>::invoke_mute(encode_callback_t encode_callback)
+    -> task<void>::future_type
+{
+    return d->sess->invoke_mute(std::move(encode_callback));
 }
 
 #include "cocaine/framework/detail/basic_session.hpp"
@@ -16,18 +16,23 @@
 
 #include "cocaine/framework/detail/shared_state.hpp"
 
+#include <limits>
+
 using namespace cocaine::framework;
 
 void shared_state_t::put(value_type&& message) {
     std::unique_lock<std::mutex> lock(mutex);
 
-    BOOST_ASSERT(!broken);
+    if (broken) {
+        return;
+    }
 
     if (await.empty()) {
         queue.push(std::move(message));
     } else {
         auto promise = await.front();
         await.pop();
+        ++consumed;
         lock.unlock();
 
         promise.set_value(std::move(message));
@@ -35,23 +40,19 @@ void shared_state_t::put(value_type&& message) {
 }
 
 void shared_state_t::put(const std::error_code& ec) {
-    std::unique_lock<std::mutex> lock(mutex);
-
-    BOOST_ASSERT(!broken);
-
-    broken = ec;
-    std::queue<task<value_type>::promise_type> await(std::move(this->await));
-    lock.unlock();
-
-    while (!await.empty()) {
-        await.front().set_exception(std::system_error(ec));
-        await.pop();
-    }
+    expire(ec, std::numeric_limits<std::uint64_t>::max());
 }
 
 auto shared_state_t::get() -> task<value_type>::future_type {
+    std::uint64_t ticket;
+    return get(ticket);
+}
+
+auto shared_state_t::get(std::uint64_t& ticket) -> task<value_type>::future_type {
     std::lock_guard<std::mutex> lock(mutex);
 
+    ticket = requested++;
+
     if (broken) {
         return make_ready_future<value_type>::error(std::system_error(broken.get()));
     }
@@ -63,5 +64,26 @@ auto shared_state_t::get() -> task<value_type>::future_type {
 
     auto future = make_ready_future<value_type>::value(std::move(queue.front()));
     queue.pop();
+    ++consumed;
     return future;
 }
+
+bool shared_state_t::expire(const std::error_code& ec, std::uint64_t ticket) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Either the connection has broken or the deadline has expired first.
+    if (broken || consumed > ticket) {
+        return false;
+    }
+
+    broken = ec;
+    std::queue<task<value_type>::promise_type> await(std::move(this->await));
+    lock.unlock();
+
+    while (!await.empty()) {
+        await.front().set_exception(std::system_error(ec));
+        await.pop();
+    }
+
+    return true;
+}
@@ -0,0 +1,242 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/timer_wheel.hpp"
+
+#include <algorithm>
+
+#include <asio/error.hpp>
+
+namespace ph = std::placeholders;
+
+using namespace cocaine::framework::detail;
+
+namespace {
+
+const std::uint64_t NEAR_MASK = (1 << 8) - 1;
+const std::uint64_t FAR_MASK = (1 << 6) - 1;
+
+} // namespace
+
+deadline_t::deadline_t(std::weak_ptr<timer_wheel_t> wheel, callback_type callback) :
+    wheel(std::move(wheel)),
+    callback(std::move(callback))
+{}
+
+deadline_t::~deadline_t() {
+    cancel();
+}
+
+void
+deadline_t::cancel() {
+    if (auto wheel = this->wheel.lock()) {
+        wheel->cancel(*this);
+    }
+}
+
+timer_wheel_t::timer_wheel_t(loop_t& loop, source_type source) :
+    source(source),
+    origin(source()),
+    tick(0),
+    size(0),
+    wakeup(0),
+    timer(loop)
+{}
+
+std::shared_ptr<deadline_t>
+timer_wheel_t::schedule(std::chrono::milliseconds timeout, callback_type callback) {
+    auto deadline = std::make_shared<deadline_t>(shared_from_this(), std::move(callback));
+
+    // The current tick has partially passed, so the deadline expires one tick later to never fire
+    // earlier than requested.
+    const auto expires = now() + static_cast<std::uint64_t>(std::max<std::int64_t>(timeout.count(), 0)) + 1;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (size == 0) {
+        // Only cancelled deadlines can be left, drop them and skip the idle period at once.
+        for (auto& slot : near) {
+            slot.clear();
+        }
+
+        for (auto& level : far) {
+            for (auto& slot : level) {
+                slot.clear();
+            }
+        }
+
+        tick = now();
+    }
+
+    place(entry_t{ expires, deadline });
+    ++size;
+
+    if (wakeup == 0 || expires < wakeup) {
+        rearm();
+    }
+
+    return deadline;
+}
+
+std::size_t
+timer_wheel_t::pending() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return size;
+}
+
+std::uint64_t
+timer_wheel_t::now() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(source() - origin).count();
+}
+
+void
+timer_wheel_t::place(entry_t&& entry) {
+    const auto expires = std::max(entry.expires, tick);
+    const auto delta = expires - tick;
+
+    if (delta <= NEAR_MASK) {
+        near[expires & NEAR_MASK].push_back(std::move(entry));
+        return;
+    }
+
+    for (std::size_t level = 0; level < far_levels; ++level) {
+        const auto shift = near_bits + far_bits * level;
+
+        if (delta >> (shift + far_bits) == 0 || level + 1 == far_levels) {
+            // Deadlines beyond the outermost level span wait in its farthest slot.
+            const auto limited = std::min(expires, tick + (std::uint64_t(1) << (shift + far_bits)) - 1);
+            far[level][(limited >> shift) & FAR_MASK].push_back(std::move(entry));
+            return;
+        }
+    }
+}
+
+void
+timer_wheel_t::cancel(deadline_t& deadline) {
+    // The callback is released after the mutex is unlocked, because it may own anything.
+    callback_type callback;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!deadline.callback) {
+        return;
+    }
+
+    std::swap(callback, deadline.callback);
+    if (--size == 0) {
+        rearm();
+    }
+}
+
+void
+timer_wheel_t::advance(std::vector<std::pair<std::shared_ptr<deadline_t>, callback_type>>& expired) {
+    const auto target = now();
+
+    while (tick < target) {
+        ++tick;
+
+        const auto index = tick & NEAR_MASK;
+        if (index == 0) {
+            for (std::size_t level = 0; level < far_levels; ++level) {
+                cascade(level);
+
+                if (((tick >> (near_bits + far_bits * level)) & FAR_MASK) != 0) {
+                    break;
+                }
+            }
+        }
+
+        slot_type slot;
+        std::swap(slot, near[index]);
+
+        for (auto& entry : slot) {
+            if (auto deadline = entry.deadline.lock()) {
+                callback_type callback;
+                if (deadline->callback) {
+                    std::swap(callback, deadline->callback);
+                    --size;
+                }
+
+                expired.emplace_back(std::move(deadline), std::move(callback));
+            }
+        }
+    }
+}
+
+void
+timer_wheel_t::cascade(std::size_t level) {
+    const auto index = (tick >> (near_bits + far_bits * level)) & FAR_MASK;
+
+    slot_type slot;
+    std::swap(slot, far[level][index]);
+
+    for (auto& entry : slot) {
+        if (!entry.deadline.expired()) {
+            place(std::move(entry));
+        }
+    }
+}
+
+void
+timer_wheel_t::rearm() {
+    if (size == 0) {
+        wakeup = 0;
+
+        std::error_code ec;
+        timer.cancel(ec);
+        return;
+    }
+
+    // Wake up either on the nearest non-empty slot or on the next cascade.
+    auto next = tick + 1;
+    while ((next & NEAR_MASK) != 0 && near[next & NEAR_MASK].empty()) {
+        ++next;
+    }
+
+    wakeup = next;
+
+    const auto delay = std::chrono::duration_cast<std::chrono::microseconds>(
+        origin + std::chrono::milliseconds(next) - source()
+    );
+
+    timer.expires_from_now(boost::posix_time::microseconds(std::max<std::int64_t>(delay.count(), 0)));
+    timer.async_wait(std::bind(&timer_wheel_t::on_timer, std::weak_ptr<timer_wheel_t>(shared_from_this()), ph::_1));
+}
+
+void
+timer_wheel_t::on_timer(std::weak_ptr<timer_wheel_t> wheel, const std::error_code& ec) {
+    if (ec == asio::error::operation_aborted) {
+        return;
+    }
+
+    auto self = wheel.lock();
+    if (!self) {
+        return;
+    }
+
+    std::vector<std::pair<std::shared_ptr<deadline_t>, callback_type>> expired;
+
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        self->advance(expired);
+        self->rearm();
+    }
+
+    for (auto& item : expired) {
+        if (item.second) {
+            item.second();
+        }
+    }
+}
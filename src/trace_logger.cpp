@@ -42,7 +42,7 @@ namespace {
         void
         operator()() {
             CF_DBG("SENDING %s ", message.c_str());
-            logger->invoke<io::log::emit>(
+            logger->invoke_mute<io::log::emit>(
                 logging::info,
                 std::string("app/trace"),
                 std::move(message),
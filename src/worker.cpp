@@ -75,12 +75,20 @@ public:
 
     std::shared_ptr<worker_session_t> session;
 
+    /// Outbound queue watermarks.
+    std::size_t high_watermark;
+    std::size_t low_watermark;
+
+    socket_options_t socket_options;
+
     impl(options_t options, std::vector<session_t::endpoint_type> entries) :
         loop(io),
         scheduler(loop),
         options(std::move(options)),
         executor(),
-        manager(std::move(entries), 1)
+        manager(std::move(entries), 1),
+        high_watermark(0),
+        low_watermark(0)
     {}
 };
 
@@ -146,10 +154,22 @@ auto worker_t::options() const -> const options_t& {
     return d->options;
 }
 
+void
+worker_t::watermarks(std::size_t high, std::size_t low) {
+    d->high_watermark = high;
+    d->low_watermark = low;
+}
+
+void
+worker_t::socket_options(socket_options_t options) {
+    d->socket_options = std::move(options);
+}
+
 int worker_t::run() {
     auto executor = std::bind(&detail::worker::executor_t::operator(), std::ref(d->executor), ph::_1);
     d->session.reset(new worker_session_t(d->dispatch, d->scheduler, executor));
-    d->session->connect(d->options.endpoint);
+    d->session->connect(d->options.endpoint, d->socket_options);
+    d->session->watermarks(d->high_watermark, d->low_watermark);
     d->session->run(d->options.uuid);
 
     // The main thread is guaranteed to work only with cocaine socket and timers.
@@ -70,6 +70,19 @@ auto worker::sender::write(std::string message) -> task<worker::sender>::future_
         .then(std::bind(&on_write, ph::_1, session));
 }
 
+auto worker::sender::write(payload_t message) -> task<worker::sender>::future_type {
+    return write(std::vector<payload_t>{ std::move(message) });
+}
+
+auto worker::sender::write(std::vector<payload_t> message) -> task<worker::sender>::future_type {
+    BOOST_ASSERT(this->session);
+
+    auto session = std::move(this->session);
+
+    return session->send_payload<protocol::chunk>(std::move(message))
+        .then(std::bind(&on_write, ph::_1, session));
+}
+
 auto worker::sender::error(int ec, std::string reason) -> task<void>::future_type {
     return error(std::error_code(ec, cocaine::service::node::worker_user_category()), std::move(reason));
 }
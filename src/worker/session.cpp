@@ -27,6 +27,7 @@
 
 #include "cocaine/framework/detail/log.hpp"
 #include "cocaine/framework/detail/loop.hpp"
+#include "cocaine/framework/detail/net.hpp"
 #include "cocaine/framework/detail/shared_state.hpp"
 
 namespace ph = std::placeholders;
@@ -43,13 +44,13 @@ const boost::posix_time::time_duration DISOWN_TIMEOUT = boost::posix_time::secon
 //! \note single shot.
 template<class Session>
 class worker_session_t::push_t : public std::enable_shared_from_this<push_t<Session>> {
-    io::encoder_t::message_type message;
+    frame_t frame;
     std::shared_ptr<Session> session;
     task<void>::promise_type h;
 
 public:
-    explicit push_t(io::encoder_t::message_type _message, std::shared_ptr<Session> session, task<void>::promise_type&& h) :
-        message(std::move(_message)),
+    explicit push_t(frame_t _frame, std::shared_ptr<Session> session, task<void>::promise_type&& h) :
+        frame(std::move(_frame)),
         session(session),
         h(std::move(h))
     {}
@@ -57,7 +58,7 @@ public:
     void operator()() {
         auto transport = session->transport.synchronize();
         if (*transport) {
-            (*transport)->writer->write(message, std::bind(&push_t::on_write, this->shared_from_this(), ph::_1));
+            (*transport)->writer->write(frame, std::bind(&push_t::on_write, this->shared_from_this(), ph::_1));
         } else {
             h.set_exception(std::system_error(asio::error::not_connected));
         }
@@ -86,11 +87,18 @@ worker_session_t::worker_session_t(dispatch_t& dispatch, scheduler_t& scheduler,
     disown_timer(scheduler.loop().loop)
 {}
 void
-worker_session_t::connect(const endpoint_type& endpoint) {
+worker_session_t::connect(const endpoint_type& endpoint, const socket_options_t& options) {
     std::unique_ptr<protocol_type::socket> socket(new protocol_type::socket(scheduler.loop().loop));
+    socket->open();
+
+    const auto ec = detail::apply(socket->native_handle(), options, false);
+    if (ec) {
+        CF_DBG("failed to apply socket options: %s", CF_EC(ec));
+    }
+
     socket->connect(endpoint);
 
-    transport->reset(new transport_type(std::move(socket)));
+    transport->reset(new transport_type(std::move(socket), scheduler.loop().wheel));
 }
 
 void
@@ -102,8 +110,18 @@ worker_session_t::run(const std::string& uuid) {
     (*transport.synchronize())->reader->read(message, std::bind(&worker_session_t::on_read, shared_from_this(), ph::_1));
 }
 
+void
+worker_session_t::watermarks(std::size_t high, std::size_t low) {
+    (*transport.synchronize())->writer->watermarks(high, low);
+}
+
 future<void>
 worker_session_t::push(io::encoder_t::message_type&& message) {
+    return push(frame_t(std::move(message)));
+}
+
+future<void>
+worker_session_t::push(frame_t&& frame) {
     promise<void> pr;
     auto fr = pr.get_future();
 
@@ -111,7 +129,7 @@ worker_session_t::push(io::encoder_t::message_type&& message) {
         std::bind(
             &push_t<worker_session_t>::operator(),
             std::make_shared<push_t<worker_session_t>>(
-                std::move(message), shared_from_this(), std::move(pr)
+                std::move(frame), shared_from_this(), std::move(pr)
             )
         )
     );
@@ -128,6 +146,11 @@ worker_session_t::revoke(std::uint64_t span) {
     });
 }
 
+std::shared_ptr<detail::deadline_t>
+worker_session_t::schedule(std::chrono::milliseconds timeout, std::function<void()> callback) {
+    return scheduler.loop().wheel->schedule(timeout, std::move(callback));
+}
+
 void worker_session_t::handshake(const std::string& uuid) {
     CF_DBG("<- Handshake");
 
@@ -161,7 +184,7 @@ void worker_session_t::exhale(const std::error_code& ec) {
 
     CF_DBG("<- ♥");
 
-    push(io::encoded<io::worker::heartbeat>(CONTROL_CHANNEL_ID));
+    push(encode_constant<io::worker::heartbeat>(CONTROL_CHANNEL_ID));
 
     heartbeat_timer.expires_from_now(HEARTBEAT_TIMEOUT);
     heartbeat_timer.async_wait(std::bind(&worker_session_t::exhale, shared_from_this(), ph::_1));
@@ -315,9 +338,9 @@ void worker_session_t::process_invoke(std::map<std::uint64_t, std::shared_ptr<sh
             !trace_id->value().empty() && !span_id->value().empty() && ! parent_id->value().empty()) {
         try {
             trace = trace_t(
-                    hpack::header::unpack<uint64_t>(message.get_header<hpack::headers::trace_id<>>()->value()),
-                    hpack::header::unpack<uint64_t>(message.get_header<hpack::headers::span_id<>>()->value()),
-                    hpack::header::unpack<uint64_t>(message.get_header<hpack::headers::parent_id<>>()->value()),
+                    hpack::header::unpack<uint64_t>(trace_id->value()),
+                    hpack::header::unpack<uint64_t>(span_id->value()),
+                    hpack::header::unpack<uint64_t>(parent_id->value()),
                     event);
         } catch (const std::exception& e) {
             CF_DBG("could not decode tracing headers - %s", e.what());
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/channel_table.hpp>
+#include <cocaine/framework/detail/shared_state.hpp>
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+
+namespace {
+
+/// Fills the table with channels of the given number of consecutive spans, which spread over all
+/// shards, returning their states by span.
+std::vector<channel_table_t::value_type>
+fill(channel_table_t& table, std::uint64_t count) {
+    std::vector<channel_table_t::value_type> states;
+    for (std::uint64_t span = 0; span < count; ++span) {
+        states.push_back(std::make_shared<shared_state_t>());
+        table.insert(span, states.back());
+    }
+
+    return states;
+}
+
+} // namespace
+
+TEST(channel_table_t, InsertsAndErases) {
+    channel_table_t table;
+    const auto states = fill(table, 3 * channel_table_t::shards_count);
+
+    EXPECT_EQ(states.size(), table.size());
+    EXPECT_EQ(states[5], table.find(5));
+    EXPECT_FALSE(table.find(states.size()));
+
+    // Duplicate spans are ignored.
+    table.insert(5, std::make_shared<shared_state_t>());
+    EXPECT_EQ(states.size(), table.size());
+    EXPECT_EQ(states[5], table.find(5));
+
+    for (std::uint64_t span = 0; span + 1 < states.size(); ++span) {
+        EXPECT_FALSE(table.erase(span));
+    }
+
+    EXPECT_FALSE(table.erase(0));
+    EXPECT_TRUE(table.erase(states.size() - 1));
+    EXPECT_TRUE(table.empty());
+}
+
+TEST(channel_table_t, FindsBatchInOrder) {
+    channel_table_t table;
+    const auto states = fill(table, 3 * channel_table_t::shards_count);
+
+    // Spans repeat, fall into the same and different shards and some of them are unknown.
+    const std::vector<std::uint64_t> spans { 7, 7 + channel_table_t::shards_count, 100500, 0, 7, states.size() };
+
+    std::vector<channel_table_t::value_type> found { nullptr };
+    table.find(spans, found);
+
+    ASSERT_EQ(spans.size() + 1, found.size());
+    EXPECT_FALSE(found[0]);
+
+    for (std::size_t id = 0; id < spans.size(); ++id) {
+        EXPECT_EQ(table.find(spans[id]), found[id + 1]) << "span " << spans[id];
+    }
+
+    EXPECT_EQ(states[7], found[1]);
+    EXPECT_FALSE(found[3]);
+}
+
+TEST(channel_table_t, DrainsAllShards) {
+    channel_table_t table;
+    const auto states = fill(table, 3 * channel_table_t::shards_count + 1);
+
+    auto drained = table.drain();
+
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(0u, table.size());
+    EXPECT_FALSE(table.find(0));
+
+    std::sort(drained.begin(), drained.end());
+    auto expected = states;
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, drained);
+
+    EXPECT_TRUE(table.drain().empty());
+}
+
+TEST(channel_table_t, DrainsAllButKept) {
+    channel_table_t table;
+    const auto states = fill(table, 3 * channel_table_t::shards_count + 1);
+
+    const std::set<std::uint64_t> kept{ 0, 7, 16, 17, 48 };
+    auto drained = table.drain_except([&](std::uint64_t span) {
+        return kept.count(span) > 0;
+    });
+
+    EXPECT_EQ(kept.size(), table.size());
+    EXPECT_EQ(states.size() - kept.size(), drained.size());
+
+    for (std::uint64_t span = 0; span < states.size(); ++span) {
+        const bool found = std::find(drained.begin(), drained.end(), states[span]) != drained.end();
+
+        if (kept.count(span) > 0) {
+            EXPECT_EQ(states[span], table.find(span));
+            EXPECT_FALSE(found);
+        } else {
+            EXPECT_FALSE(table.find(span));
+            EXPECT_TRUE(found);
+        }
+    }
+
+    // The size is kept consistent, so erasing the rest empties the table.
+    for (auto span : kept) {
+        table.erase(span);
+    }
+
+    EXPECT_TRUE(table.empty());
+}
+
+TEST(channel_table_t, CountsConcurrentChanges) {
+    channel_table_t table;
+
+    const std::uint64_t threads = 4;
+    const std::uint64_t count = 10000;
+
+    // Each thread inserts its own spans, erasing every other one, so all shards are hit at once.
+    std::vector<std::unique_ptr<boost::thread>> pool;
+    for (std::uint64_t id = 0; id < threads; ++id) {
+        pool.emplace_back(new boost::thread([&table, id, threads, count] {
+            for (std::uint64_t span = id; span < threads * count; span += threads) {
+                table.insert(span, std::make_shared<shared_state_t>());
+                if (span % 2 == 0) {
+                    table.erase(span);
+                }
+            }
+        }));
+    }
+
+    for (auto& thread : pool) {
+        thread->join();
+    }
+
+    EXPECT_EQ(threads * count / 2, table.size());
+    EXPECT_EQ(threads * count / 2, table.drain_except([](std::uint64_t) { return false; }).size());
+    EXPECT_TRUE(table.empty());
+}
@@ -0,0 +1,302 @@
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <msgpack.hpp>
+
+#include <cocaine/errors.hpp>
+#include <cocaine/hpack/header.hpp>
+#include <cocaine/hpack/static_table.hpp>
+
+#include <cocaine/framework/message.hpp>
+
+#include <cocaine/framework/detail/buffer.hpp>
+#include <cocaine/framework/detail/decoder.hpp>
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+
+namespace {
+
+/// Packs a protocol frame with the given arguments.
+template<class... Args>
+void
+pack(msgpack::sbuffer& out, std::uint64_t span, std::uint64_t type, const Args&... args) {
+    msgpack::packer<msgpack::sbuffer> packer(out);
+    packer.pack_array(3);
+    packer.pack(span);
+    packer.pack(type);
+    packer.pack_array(sizeof...(Args));
+
+    const int expand[] = { 0, (packer.pack(args), 0)... };
+    (void)expand;
+}
+
+std::shared_ptr<buffer_t>
+make_buffer(const char* data, std::size_t size) {
+    auto buffer = std::make_shared<buffer_t>(size);
+    std::memcpy(buffer->data(), data, size);
+    return buffer;
+}
+
+} // namespace
+
+TEST(decoder_t, DecodesFrameReceivedByteByByte) {
+    msgpack::sbuffer frame;
+    pack(frame, 42, 1, std::string("le message"), std::map<std::string, int>{{ "key", 100500 }});
+
+    const auto buffer = make_buffer(frame.data(), frame.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    // Each call sees one more byte, as if the frame was split into the smallest reads possible.
+    for (std::size_t size = 1; size < frame.size(); ++size) {
+        std::error_code ec;
+        EXPECT_EQ(0u, decoder.decode(buffer, 0, size, message, ec));
+        EXPECT_EQ(cocaine::error::insufficient_bytes, ec);
+        EXPECT_GT(decoder.needed(), 0u);
+        EXPECT_LE(decoder.needed(), frame.size() - size);
+    }
+
+    std::error_code ec;
+    EXPECT_EQ(frame.size(), decoder.decode(buffer, 0, frame.size(), message, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(42u, message.span());
+    EXPECT_EQ(1u, message.type());
+
+    const auto& args = message.args();
+    ASSERT_EQ(2u, args.via.array.size);
+    EXPECT_EQ("le message", args.via.array.ptr[0].as<std::string>());
+    EXPECT_EQ(100500, (args.via.array.ptr[1].as<std::map<std::string, int>>()["key"]));
+}
+
+TEST(decoder_t, ReportsMissingPayloadAtOnce) {
+    const std::string payload(100000, 'x');
+
+    msgpack::sbuffer frame;
+    pack(frame, 1, 0, payload);
+
+    const auto buffer = make_buffer(frame.data(), frame.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    // The string header is complete after the first 10 bytes, so the whole payload is requested.
+    std::error_code ec;
+    decoder.decode(buffer, 0, 10, message, ec);
+    EXPECT_EQ(cocaine::error::insufficient_bytes, ec);
+    EXPECT_EQ(frame.size() - 10, decoder.needed());
+
+    ec.clear();
+    EXPECT_EQ(frame.size(), decoder.decode(buffer, 0, frame.size(), message, ec));
+    EXPECT_FALSE(ec);
+}
+
+TEST(decoder_t, DecodesSubsequentFramesAfterSplitOne) {
+    msgpack::sbuffer frames;
+    pack(frames, 1, 0, std::string("first"));
+    const auto first = frames.size();
+    pack(frames, 2, 0, std::string("second"));
+
+    const auto buffer = make_buffer(frames.data(), frames.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    std::error_code ec;
+    decoder.decode(buffer, 0, first / 2, message, ec);
+    EXPECT_EQ(cocaine::error::insufficient_bytes, ec);
+
+    ec.clear();
+    EXPECT_EQ(first, decoder.decode(buffer, 0, frames.size(), message, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(1u, message.span());
+
+    // The scanner has been reset after the first frame, so the second one starts afresh.
+    EXPECT_EQ(frames.size() - first, decoder.decode(buffer, first, frames.size() - first, message, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(2u, message.span());
+}
+
+TEST(decoder_t, RejectsOversizedFrame) {
+    // The frame announces a binary argument of 2 GiB, but only its header is received.
+    const char frame[] = {
+        '\x93', '\x01', '\x00', '\x91', '\xc6', '\x80', '\x00', '\x00', '\x00'
+    };
+
+    const auto buffer = make_buffer(frame, sizeof(frame));
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    std::error_code ec;
+    EXPECT_EQ(0u, decoder.decode(buffer, 0, sizeof(frame), message, ec));
+    EXPECT_EQ(cocaine::error::frame_format_error, ec);
+    EXPECT_LE(decoder.needed(), decoder_t::max_frame_size);
+}
+
+TEST(decoder_t, RejectsFrameGrowingBeyondLimit) {
+    // Each element is small, but their number makes the frame exceed the limit.
+    frame_scanner_t scanner(64);
+
+    msgpack::sbuffer frame;
+    msgpack::packer<msgpack::sbuffer> packer(frame);
+    packer.pack_array(100);
+    for (int i = 0; i < 100; ++i) {
+        packer.pack(i);
+    }
+
+    std::error_code ec;
+    EXPECT_EQ(0u, scanner.scan(frame.data(), frame.size(), ec));
+    EXPECT_EQ(cocaine::error::frame_format_error, ec);
+}
+
+TEST(frame_scanner_t, FindsBoundaryAcrossSplitReads) {
+    msgpack::sbuffer frame;
+    msgpack::packer<msgpack::sbuffer> packer(frame);
+    packer.pack_array(4);
+    packer.pack(std::vector<std::string>{ "a", std::string(300, 'b'), "c" });
+    packer.pack(std::map<int, std::vector<int>>{{ 1, { 2, 3 } }, { 4, {} }});
+    packer.pack(3.14);
+    packer.pack(-100500);
+
+    // Trailing garbage must not be taken for a part of the frame.
+    const auto size = frame.size();
+    frame.write("\xc1\xc1", 2);
+
+    for (std::size_t split = 1; split < size; ++split) {
+        frame_scanner_t scanner(decoder_t::max_frame_size);
+
+        std::error_code ec;
+        EXPECT_EQ(0u, scanner.scan(frame.data(), split, ec));
+        EXPECT_FALSE(ec);
+
+        EXPECT_EQ(size, scanner.scan(frame.data(), frame.size(), ec)) << "split at " << split;
+        EXPECT_FALSE(ec);
+    }
+}
+
+TEST(frame_scanner_t, RejectsFrameNestedTooDeep) {
+    // Each nested array is a single byte, so the frame is tiny however deep it is.
+    const std::string deep(frame_scanner_t::max_depth + 1, '\x91');
+    const std::string shallow(frame_scanner_t::max_depth, '\x91');
+
+    {
+        frame_scanner_t scanner(decoder_t::max_frame_size);
+
+        const auto frame = deep + '\x00';
+        std::error_code ec;
+        EXPECT_EQ(0u, scanner.scan(frame.data(), frame.size(), ec));
+        EXPECT_EQ(cocaine::error::frame_format_error, ec);
+    }
+
+    {
+        frame_scanner_t scanner(decoder_t::max_frame_size);
+
+        const auto frame = shallow + '\x00';
+        std::error_code ec;
+        EXPECT_EQ(frame.size(), scanner.scan(frame.data(), frame.size(), ec));
+        EXPECT_FALSE(ec);
+    }
+}
+
+TEST(decoder_t, RejectsFrameNestedTooDeep) {
+    // A stream of nested arrays is rejected as soon as the depth is exceeded, without waiting for
+    // the rest of the frame.
+    const std::string frame = std::string("\x93\x01\x00", 3) + std::string(frame_scanner_t::max_depth, '\x91');
+
+    const auto buffer = make_buffer(frame.data(), frame.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    std::error_code ec;
+    EXPECT_EQ(0u, decoder.decode(buffer, 0, frame.size(), message, ec));
+    EXPECT_EQ(cocaine::error::frame_format_error, ec);
+}
+
+TEST(decoder_t, RejectsFrameWithoutArguments) {
+    // The envelope is a well-formed array, but its third element is not an array.
+    msgpack::sbuffer frame;
+    msgpack::packer<msgpack::sbuffer> packer(frame);
+    packer.pack_array(3);
+    packer.pack(1);
+    packer.pack(0);
+    packer.pack(std::string("args"));
+
+    const auto buffer = make_buffer(frame.data(), frame.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    std::error_code ec;
+    EXPECT_EQ(frame.size(), decoder.decode(buffer, 0, frame.size(), message, ec));
+    EXPECT_EQ(cocaine::error::frame_format_error, ec);
+}
+
+TEST(decoded_message, FindsFirstHeaderWithTheName) {
+    using namespace cocaine::hpack;
+
+    std::vector<header_t> headers {
+        header_t::create<headers::trace_id<>>(header::pack(std::uint64_t(1))),
+        header_t::create<headers::span_id<>>(header::pack(std::uint64_t(2))),
+        header_t::create<headers::trace_id<>>(header::pack(std::uint64_t(3)))
+    };
+
+    decoded_message message(msgpack::object(), std::unique_ptr<msgpack::zone>(new msgpack::zone), {}, headers);
+
+    // Lookups after the first one use the index built by it.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const auto trace = message.get_header<headers::trace_id<>>();
+        ASSERT_TRUE(trace);
+        EXPECT_EQ(1u, header::unpack<std::uint64_t>(trace->value()));
+
+        const auto span = message.get_header<headers::span_id<>>();
+        ASSERT_TRUE(span);
+        EXPECT_EQ(2u, header::unpack<std::uint64_t>(span->value()));
+
+        EXPECT_FALSE(message.get_header<headers::parent_id<>>());
+    }
+
+    // The index moves along with the headers.
+    decoded_message moved(std::move(message));
+    const auto trace = moved.get_header<headers::trace_id<>>();
+    ASSERT_TRUE(trace);
+    EXPECT_EQ(1u, header::unpack<std::uint64_t>(trace->value()));
+}
+
+TEST(decoded_message, LeavesMovedFromMessageEmpty) {
+    msgpack::sbuffer frame;
+    pack(frame, 42, 1, std::string("le message"));
+
+    const auto buffer = make_buffer(frame.data(), frame.size());
+
+    decoder_t decoder;
+    decoded_message message(boost::none);
+
+    std::error_code ec;
+    EXPECT_EQ(frame.size(), decoder.decode(buffer, 0, frame.size(), message, ec));
+    ASSERT_FALSE(ec);
+
+    // The arguments are still encoded, so the moved-from message must not try to unpack them.
+    decoded_message moved(std::move(message));
+    EXPECT_EQ(0u, message.span());
+    EXPECT_EQ(msgpack::type::NIL, message.args().type);
+    EXPECT_EQ(nullptr, message.raw_args().first);
+
+    EXPECT_EQ(42u, moved.span());
+    EXPECT_EQ("le message", moved.args().via.array.ptr[0].as<std::string>());
+
+    decoded_message assigned(boost::none);
+    assigned = std::move(moved);
+    EXPECT_EQ(msgpack::type::NIL, moved.args().type);
+    EXPECT_EQ("le message", assigned.args().via.array.ptr[0].as<std::string>());
+}
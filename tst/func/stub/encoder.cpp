@@ -0,0 +1,158 @@
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/hpack/header.hpp>
+#include <cocaine/hpack/static_table.hpp>
+#include <cocaine/idl/streaming.hpp>
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+
+namespace {
+
+typedef io::streaming<std::string>::chunk chunk_type;
+
+/// Spans of every MessagePack unsigned integer width.
+const std::vector<std::uint64_t> spans { 1, 200, 70000, 1ULL << 40 };
+
+/// Sizes around every MessagePack raw header width.
+const std::vector<std::size_t> sizes { 0, 5, 31, 32, 300, 70000 };
+
+/// Concatenates the frame buffers in the order they are written.
+std::string
+flatten(const frame_t& frame) {
+    std::vector<asio::const_buffer> buffers;
+    frame.gather(buffers);
+
+    std::string result;
+    for (const auto& buffer : buffers) {
+        result.append(asio::buffer_cast<const char*>(buffer), asio::buffer_size(buffer));
+    }
+
+    return result;
+}
+
+/// Encodes the event using the reference encoder.
+template<class Event, class... Args>
+std::string
+encoded(std::uint64_t span, const Args&... args) {
+    const io::encoded<Event> message(span, args...);
+    return std::string(message.data(), message.size());
+}
+
+} // namespace
+
+TEST(frame_t, PayloadEncodingMatchesEncoder) {
+    for (auto span : spans) {
+        for (auto size : sizes) {
+            // The payload is split into two regions, which must be written as a single string.
+            auto head = std::make_shared<std::string>(size / 2, 'a');
+            auto tail = std::make_shared<std::string>(size - size / 2, 'b');
+
+            const auto frame = encode_payload<chunk_type>(span, { head, tail });
+
+            EXPECT_EQ(flatten(frame).size(), frame.size());
+            EXPECT_EQ(encoded<chunk_type>(span, *head + *tail), flatten(frame))
+                << "span " << span << ", size " << size;
+        }
+    }
+}
+
+TEST(frame_t, ConstantEncodingMatchesEncoder) {
+    typedef io::streaming<std::string>::choke choke_type;
+
+    for (auto span : spans) {
+        EXPECT_EQ(encoded<choke_type>(span), flatten(encode_constant<choke_type>(span)));
+    }
+}
+
+TEST(frame_t, TemplateEncodingMatchesEncoder) {
+    for (auto size : sizes) {
+        // Short arguments are copied into the frame head, long ones are referenced.
+        const std::string data(size, 'x');
+        const frame_template_t<chunk_type> frame(data);
+
+        for (auto span : spans) {
+            EXPECT_EQ(encoded<chunk_type>(span, data), flatten(frame(span)))
+                << "span " << span << ", size " << size;
+        }
+    }
+}
+
+TEST(frame_t, PooledEncodingMatchesEncoder) {
+    for (auto size : sizes) {
+        const std::string data(size, 'x');
+
+        for (auto span : spans) {
+            const auto frame = encode_pooled<chunk_type>(span, data);
+
+            EXPECT_EQ(flatten(frame).size(), frame.size());
+            EXPECT_EQ(encoded<chunk_type>(span, data), flatten(frame))
+                << "span " << span << ", size " << size;
+        }
+    }
+}
+
+TEST(frame_t, RebindingMatchesEncoder) {
+    const std::string data(100, 'x');
+    const frame_template_t<chunk_type> frame(data);
+
+    // Rebinding changes the span width in both directions.
+    for (auto from : spans) {
+        for (auto to : spans) {
+            auto pooled = encode_pooled<chunk_type>(from, data);
+            pooled.rebind(to);
+            EXPECT_EQ(encoded<chunk_type>(to, data), flatten(pooled)) << "span " << from << " -> " << to;
+
+            auto payload = encode_payload<chunk_type>(from, { std::make_shared<std::string>(data) });
+            payload.rebind(to);
+            EXPECT_EQ(encoded<chunk_type>(to, data), flatten(payload)) << "span " << from << " -> " << to;
+
+            auto inlined = frame_template_t<chunk_type>(std::string("x"))(from);
+            inlined.rebind(to);
+            EXPECT_EQ(encoded<chunk_type>(to, std::string("x")), flatten(inlined)) << "span " << from << " -> " << to;
+        }
+    }
+}
+
+TEST(frame_t, AttachMarksHeadersInMessageArray) {
+    auto frame = encode_constant<io::streaming<std::string>::choke>(1);
+    frame.attach({
+        hpack::header_t::create<hpack::headers::trace_id<>>(hpack::header::pack(std::uint64_t(42)))
+    });
+
+    ASSERT_EQ(1u, frame.headers().size());
+    EXPECT_EQ(42u, hpack::header::unpack<std::uint64_t>(frame.headers()[0].value()));
+
+    const auto head = flatten(frame);
+    EXPECT_EQ(0x94, static_cast<unsigned char>(head[0]));
+
+    // Frames with headers can still be rebound, but headers are attached only once.
+    frame.rebind(1ULL << 40);
+    EXPECT_EQ(0x94, static_cast<unsigned char>(flatten(frame)[0]));
+    EXPECT_THROW(frame.attach({}), std::logic_error);
+}
+
+TEST(frame_t, RejectsHeadersAndRebindingOfEncodedMessages) {
+    frame_t frame(io::encoded<chunk_type>(1, std::string("x")));
+
+    // Such frames are rejected regardless of the headers given.
+    EXPECT_THROW(frame.attach({}), std::logic_error);
+    EXPECT_THROW(frame.attach({
+        hpack::header_t::create<hpack::headers::trace_id<>>(hpack::header::pack(std::uint64_t(42)))
+    }), std::logic_error);
+    EXPECT_THROW(frame.rebind(2), std::logic_error);
+
+    EXPECT_EQ(encoded<chunk_type>(1, std::string("x")), flatten(frame));
+    EXPECT_TRUE(frame.headers().empty());
+}
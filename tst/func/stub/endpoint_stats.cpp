@@ -0,0 +1,66 @@
+#include <chrono>
+#include <vector>
+
+#include <asio/ip/tcp.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/endpoint_stats.hpp>
+
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+
+namespace {
+
+typedef endpoint_stats_t::endpoint_type endpoint_type;
+
+endpoint_type
+endpoint(unsigned short port) {
+    return endpoint_type(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), port));
+}
+
+} // namespace
+
+TEST(endpoint_stats_t, KeepsOrderOfUnknownEndpoints) {
+    endpoint_stats_t stats;
+
+    const std::vector<endpoint_type> endpoints { endpoint(3), endpoint(1), endpoint(2) };
+    EXPECT_EQ(endpoints, stats.order(endpoints));
+}
+
+TEST(endpoint_stats_t, OrdersHealthyEndpointsByRoundTripTime) {
+    endpoint_stats_t stats;
+
+    const auto fast = endpoint(1);
+    const auto slow = endpoint(2);
+    const auto unknown = endpoint(3);
+    const auto failed = endpoint(4);
+
+    stats.success(slow, std::chrono::microseconds(300));
+    stats.success(fast, std::chrono::microseconds(100));
+    stats.failure(failed);
+
+    // The unknown endpoint is ranked with the mean round-trip time, failed ones go last.
+    const std::vector<endpoint_type> expected { fast, unknown, slow, failed };
+    EXPECT_EQ(expected, stats.order({ failed, unknown, slow, fast }));
+}
+
+TEST(endpoint_stats_t, DropsStatisticsOfVanishedEndpoints) {
+    endpoint_stats_t stats;
+
+    const auto kept = endpoint(1);
+    const auto vanished = endpoint(2);
+
+    stats.failure(kept);
+    stats.failure(vanished);
+
+    stats.order({ kept });
+
+    EXPECT_LT(0.0, stats.get(kept).errors);
+    EXPECT_EQ(0.0, stats.get(vanished).errors);
+
+    // An empty resolve result keeps everything.
+    stats.order({});
+    EXPECT_LT(0.0, stats.get(kept).errors);
+}
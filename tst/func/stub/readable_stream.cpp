@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/write.hpp>
+
+#include <gtest/gtest.h>
+
+#include <msgpack.hpp>
+
+#include <cocaine/framework/message.hpp>
+
+#include <cocaine/framework/detail/buffer.hpp>
+#include <cocaine/framework/detail/readable_stream.hpp>
+#include <cocaine/framework/detail/timer_wheel.hpp>
+
+#include "../../util/net.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+
+namespace {
+
+/// Milliseconds passed since the fake epoch.
+std::atomic<std::uint64_t> elapsed(0);
+
+timer_wheel_t::clock_type::time_point
+fake_now() {
+    return timer_wheel_t::clock_type::time_point(std::chrono::milliseconds(elapsed.load()));
+}
+
+typedef asio::local::stream_protocol protocol_type;
+typedef readable_stream_t<protocol_type> stream_type;
+
+/// Writes a frame carrying the given string to the socket.
+void
+send(protocol_type::socket& socket, const std::string& data) {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    packer.pack_array(3);
+    packer.pack(1);
+    packer.pack(0);
+    packer.pack_array(1);
+    packer.pack(data);
+
+    asio::write(socket, asio::buffer(buffer.data(), buffer.size()));
+}
+
+/// Checks whether a buffer containing the given marker can be taken from the pool.
+///
+/// Buffers are taken until the marker is found or the pool is exhausted, then all of them are
+/// returned.
+bool
+pooled(const std::string& marker, std::size_t size) {
+    auto& pool = buffer_pool_t::instance();
+
+    std::vector<std::shared_ptr<buffer_t>> buffers;
+    bool found = false;
+
+    for (std::size_t id = 0; id < 300 && !found; ++id) {
+        buffers.push_back(pool.acquire(size));
+
+        const auto& buffer = buffers.back();
+        found = std::search(buffer->data(), buffer->data() + buffer->size(), marker.begin(), marker.end())
+            != buffer->data() + buffer->size();
+    }
+
+    for (auto& buffer : buffers) {
+        pool.release(std::move(buffer));
+    }
+
+    return found;
+}
+
+} // namespace
+
+TEST(readable_stream_t, ReleasesBufferWhileIdle) {
+    util::client_t client;
+
+    auto socket = std::make_shared<protocol_type::socket>(client.loop());
+    protocol_type::socket peer(client.loop());
+    asio::local::connect_pair(*socket, peer);
+
+    // The wheel runs on the fake time, so the idle period passes without waiting for it.
+    elapsed = 0;
+    auto wheel = std::make_shared<timer_wheel_t>(client.loop(), &fake_now);
+    auto stream = std::make_shared<stream_type>(socket, wheel);
+
+    const std::string marker = "idle-buffer-marker-" + std::to_string(::getpid());
+    send(peer, marker);
+
+    std::unique_ptr<decoded_message> message(new decoded_message(boost::none));
+    decoded_message next(boost::none);
+
+    std::promise<std::error_code> received;
+    stream->read(*message, [&](const std::error_code& ec) {
+        // Waits for the next message with nothing pending.
+        stream->read(next, [](const std::error_code&) {});
+        received.set_value(ec);
+    });
+
+    ASSERT_EQ(std::error_code(), received.get_future().get());
+    EXPECT_EQ(marker, message->args().via.array.ptr[0].as<std::string>());
+
+    // The stream keeps its buffer until it has been idle for a while.
+    message.reset();
+    EXPECT_FALSE(pooled(marker, 65536));
+
+    // The witness expires after the idle check, which runs on the same loop.
+    std::promise<void> passed;
+    auto witness = wheel->schedule(std::chrono::milliseconds(1500), [&passed] {
+        passed.set_value();
+    });
+
+    elapsed = 2000;
+    ASSERT_EQ(std::future_status::ready, passed.get_future().wait_for(std::chrono::seconds(5)));
+
+    EXPECT_TRUE(pooled(marker, 65536));
+
+    peer.close();
+}
+
+TEST(readable_stream_t, CountsReadsReturningData) {
+    util::client_t client;
+
+    auto socket = std::make_shared<protocol_type::socket>(client.loop());
+    protocol_type::socket peer(client.loop());
+    asio::local::connect_pair(*socket, peer);
+
+    auto stream = std::make_shared<stream_type>(socket, nullptr);
+
+    std::vector<decoded_message> batch;
+
+    // Returns the number of reads with data after the next batch, counted on the loop thread.
+    auto next = [&]() -> std::uint64_t {
+        std::promise<std::uint64_t> received;
+        stream->read(batch, [&](const std::error_code& ec) {
+            EXPECT_EQ(std::error_code(), ec);
+            received.set_value(stream->received());
+        });
+
+        return received.get_future().get();
+    };
+
+    EXPECT_EQ(0u, stream->received());
+
+    send(peer, "first");
+    EXPECT_EQ(1u, next());
+    EXPECT_EQ(1u, batch.size());
+
+    // Both frames arrive with a single read, so they are counted once.
+    batch.clear();
+    send(peer, "second");
+    send(peer, "third");
+    EXPECT_EQ(2u, next());
+    EXPECT_EQ(2u, batch.size());
+
+    peer.close();
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <asio/write.hpp>
+
+#include <gtest/gtest.h>
+
+#include <msgpack.hpp>
+
+#include <cocaine/common.hpp>
+#include <cocaine/errors.hpp>
+#include <cocaine/idl/node.hpp>
+
+#include <cocaine/framework/manager.hpp>
+#include <cocaine/framework/service.hpp>
+
+#include <cocaine/framework/detail/decoder.hpp>
+
+#include "../../util/net.hpp"
+
+using namespace cocaine::framework;
+
+using namespace testing;
+
+namespace {
+
+typedef asio::ip::tcp::socket socket_type;
+
+/// Reads protocol frames from the socket, keeping the bytes of the next frame between calls.
+class reader_t {
+    socket_type& socket;
+    detail::decoder_t decoder;
+    std::vector<char> data;
+
+public:
+    explicit
+    reader_t(socket_type& socket) :
+        socket(socket)
+    {}
+
+    /// Reads the next frame, returning its first argument.
+    std::string
+    next() {
+        std::array<char, 4096> chunk;
+
+        while (true) {
+            std::error_code ec;
+            if (!data.empty()) {
+                decoded_message message(boost::none);
+                const auto consumed = decoder.decode(data.data(), data.size(), message, ec);
+                if (!ec) {
+                    data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(consumed));
+                    return message.args().via.array.ptr[0].as<std::string>();
+                }
+
+                EXPECT_EQ(cocaine::error::insufficient_bytes, ec);
+            }
+
+            const auto size = socket.read_some(asio::buffer(chunk));
+            data.insert(data.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(size));
+        }
+    }
+};
+
+/// Stub Locator, which resolves any service to the given port.
+class locator_t {
+    std::atomic<bool> stopped;
+
+public:
+    const std::uint16_t port;
+
+private:
+    util::server_t server;
+
+public:
+    locator_t(std::uint16_t service, uint version) :
+        stopped(false),
+        port(util::port()),
+        server(port, [this, service, version](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+            serve(acceptor, loop, service, version);
+        })
+    {}
+
+    ~locator_t() {
+        stopped = true;
+    }
+
+private:
+    void
+    serve(asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop, std::uint16_t service, uint version) {
+        // The number of resolves depends on how they are serialized, so accept until stopped.
+        acceptor.non_blocking(true);
+
+        std::vector<std::unique_ptr<socket_type>> sockets;
+        while (!stopped) {
+            std::unique_ptr<socket_type> socket(new socket_type(loop));
+
+            std::error_code ec;
+            acceptor.accept(*socket, ec);
+            if (ec) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            socket->non_blocking(false);
+
+            detail::decoder_t decoder;
+            std::vector<char> data;
+            decoded_message message(boost::none);
+            std::array<char, 4096> chunk;
+            do {
+                const auto size = socket->read_some(asio::buffer(chunk), ec);
+                if (ec) {
+                    break;
+                }
+
+                data.insert(data.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(size));
+                decoder.decode(data.data(), data.size(), message, ec);
+            } while (ec == cocaine::error::insufficient_bytes);
+
+            if (ec) {
+                continue;
+            }
+
+            // [span, value, [[[address, port]], version, {}]].
+            msgpack::sbuffer buffer;
+            msgpack::packer<msgpack::sbuffer> packer(buffer);
+            packer.pack_array(3);
+            packer.pack(message.span());
+            packer.pack(0);
+            packer.pack_array(3);
+            packer.pack_array(1);
+            packer.pack_array(2);
+            packer.pack(std::string("127.0.0.1"));
+            packer.pack(service);
+            packer.pack(version);
+            packer.pack_map(0);
+
+            asio::write(*socket, asio::buffer(buffer.data(), buffer.size()), ec);
+            sockets.push_back(std::move(socket));
+        }
+    }
+};
+
+} // namespace
+
+TEST(basic_service_t, InvokesOverLeastLoadedConnection) {
+    typedef cocaine::io::app::enqueue event_type;
+
+    const std::size_t count = 3;
+
+    std::promise<std::vector<std::shared_ptr<socket_type>>> accepted;
+    auto connections = accepted.get_future();
+
+    const std::uint16_t port = util::port();
+    util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+        std::vector<std::shared_ptr<socket_type>> sockets;
+        for (std::size_t id = 0; id < count; ++id) {
+            sockets.push_back(std::make_shared<socket_type>(loop));
+            acceptor.accept(*sockets.back());
+        }
+
+        accepted.set_value(sockets);
+    });
+
+    locator_t locator(port, cocaine::io::protocol<cocaine::io::app_tag>::version::value);
+
+    service_manager_t manager({ service_manager_t::endpoint_type(boost::asio::ip::address_v4::loopback(), locator.port) }, 1);
+
+    auto service = manager.create<cocaine::io::app_tag>("app");
+    service.connections(count);
+    service.connect().get();
+
+    const auto sockets = connections.get();
+
+    std::vector<std::unique_ptr<reader_t>> readers;
+    for (const auto& socket : sockets) {
+        readers.emplace_back(new reader_t(*socket));
+    }
+
+    // Idle connections are taken in turn, so each of them gets a single invocation.
+    std::vector<channel<event_type>> channels;
+    for (std::size_t id = 0; id < count; ++id) {
+        channels.push_back(service.invoke<event_type>(std::to_string(id)).get());
+    }
+
+    std::vector<std::string> events;
+    for (const auto& reader : readers) {
+        events.push_back(reader->next());
+    }
+
+    EXPECT_EQ(count, std::set<std::string>(events.begin(), events.end()).size());
+
+    // Revoking a channel makes its connection the least loaded one.
+    const auto revoked = std::find(events.begin(), events.end(), "1") - events.begin();
+    channels.erase(channels.begin() + 1);
+
+    channels.push_back(service.invoke<event_type>(std::string("next")).get());
+    EXPECT_EQ("next", readers[revoked]->next());
+}
@@ -1,8 +1,424 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <asio/local/stream_protocol.hpp>
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <msgpack.hpp>
+
+#include <cocaine/errors.hpp>
+#include <cocaine/idl/locator.hpp>
+#include <cocaine/idl/node.hpp>
+
 #include <cocaine/framework/session.hpp>
 
+#include <cocaine/framework/detail/basic_session.hpp>
+#include <cocaine/framework/detail/decoder.hpp>
+#include <cocaine/framework/detail/loop.hpp>
+
+#include "../../util/net.hpp"
+
 using namespace cocaine::framework;
 
 using namespace testing;
+
+namespace {
+
+typedef cocaine::io::locator::resolve event_type;
+
+basic_session_t::endpoint_type
+endpoint(std::uint16_t port) {
+    return basic_session_t::endpoint_type(boost::asio::ip::address_v4::loopback(), port);
+}
+
+frame_t
+encode(std::uint64_t span) {
+    return encode_pooled<event_type>(span, std::string("stub"));
+}
+
+/// Reads frames from the socket until the given number of them is received, returning their spans
+/// and, optionally, types in the order received.
+template<class Socket>
+std::vector<std::uint64_t>
+receive(Socket& socket, std::size_t count, std::vector<std::uint64_t>* types = nullptr) {
+    detail::decoder_t decoder;
+    std::vector<char> data;
+    std::vector<std::uint64_t> spans;
+    std::array<char, 4096> chunk;
+
+    while (spans.size() < count) {
+        std::error_code ec;
+        const auto size = socket.read_some(asio::buffer(chunk), ec);
+        if (ec) {
+            break;
+        }
+
+        data.insert(data.end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(size));
+
+        while (!data.empty()) {
+            decoded_message message(boost::none);
+            const auto consumed = decoder.decode(data.data(), data.size(), message, ec);
+            if (ec == cocaine::error::insufficient_bytes) {
+                break;
+            }
+
+            EXPECT_FALSE(ec);
+            spans.push_back(message.span());
+            if (types) {
+                types->push_back(message.type());
+            }
+
+            data.erase(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(consumed));
+        }
+    }
+
+    return spans;
+}
+
+/// Sends the terminal value of each given span.
+template<class Socket>
+void
+reply(Socket& socket, const std::vector<std::uint64_t>& spans) {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+
+    for (auto span : spans) {
+        packer.pack_array(3);
+        packer.pack(span);
+        packer.pack(0);
+        packer.pack_array(0);
+    }
+
+    asio::write(socket, asio::buffer(buffer.data(), buffer.size()));
+}
+
+/// Reads from the socket until the client hangs up.
+template<class Socket>
+void
+drain(Socket& socket) {
+    std::error_code ec;
+    std::array<char, 4096> chunk;
+    while (!ec) {
+        socket.read_some(asio::buffer(chunk), ec);
+    }
+}
+
+} // namespace
+
+TEST(basic_session_t, FlushesBacklogInSpanOrder) {
+    const std::size_t threads = 4;
+    const std::size_t count = 25;
+
+    std::promise<std::vector<std::uint64_t>> received;
+    auto spans = received.get_future();
+
+    const std::uint16_t port = util::port();
+    util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+        asio::ip::tcp::socket socket(loop);
+        acceptor.accept(socket);
+
+        received.set_value(receive(socket, threads * count));
+        drain(socket);
+    });
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    auto session = std::make_shared<basic_session_t>(scheduler);
+
+    {
+        util::blocker_t blocker(client.loop());
+
+        auto connected = session->connect(endpoint(port));
+        ASSERT_TRUE(session->connecting());
+
+        // Invocations made from several threads while connecting are all queued, each allocating
+        // its span and queueing its frame atomically.
+        std::mutex mutex;
+        std::vector<future<basic_session_t::invoke_result>> invokes;
+        std::vector<std::thread> workers;
+
+        for (std::size_t id = 0; id < threads; ++id) {
+            workers.emplace_back([&] {
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto invoke = session->invoke(&encode);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    invokes.push_back(std::move(invoke));
+                }
+            });
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        EXPECT_TRUE(session->connecting());
+        EXPECT_EQ(threads * count, session->load());
+
+        blocker.release();
+        EXPECT_EQ(std::error_code(), connected.get());
+
+        for (auto& invoke : invokes) {
+            EXPECT_NO_THROW(invoke.get());
+        }
+    }
+
+    const auto result = spans.get();
+    ASSERT_EQ(threads * count, result.size());
+
+    // The service requires spans of new channels to increase.
+    EXPECT_EQ(result.end(), std::adjacent_find(result.begin(), result.end(), [](std::uint64_t lhs, std::uint64_t rhs) {
+        return lhs >= rhs;
+    }));
+
+    session->cancel();
+}
+
+TEST(basic_session_t, FailsBacklogWhenConnectFails) {
+    // Nobody listens on the port.
+    const std::uint16_t port = util::port();
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    auto session = std::make_shared<basic_session_t>(scheduler);
+
+    util::blocker_t blocker(client.loop());
+
+    auto connected = session->connect(endpoint(port));
+    ASSERT_TRUE(session->connecting());
+
+    std::vector<future<basic_session_t::invoke_result>> invokes;
+    for (int i = 0; i < 10; ++i) {
+        invokes.push_back(session->invoke(&encode));
+    }
+
+    blocker.release();
+    EXPECT_TRUE(connected.get());
+
+    for (auto& invoke : invokes) {
+        EXPECT_THROW(invoke.get(), std::system_error);
+    }
+
+    EXPECT_FALSE(session->connecting());
+    EXPECT_FALSE(session->connected());
+    EXPECT_EQ(0u, session->load());
+
+    // Frames sent after the failure are not queued anymore.
+    EXPECT_THROW(session->invoke(&encode).get(), std::system_error);
+}
+
+TEST(session_t, CancelsStreamingChannelRemotely) {
+    typedef cocaine::io::app::enqueue event_type;
+
+    std::promise<std::vector<std::uint64_t>> received;
+    auto frames = received.get_future();
+
+    const std::uint16_t port = util::port();
+    util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+        asio::ip::tcp::socket socket(loop);
+        acceptor.accept(socket);
+
+        // The invocation, followed by the error, which cancels it.
+        std::vector<std::uint64_t> types;
+        const auto spans = receive(socket, 2, &types);
+        received.set_value(types);
+
+        // The service has not seen the cancellation yet, so it keeps responding.
+        reply(socket, { spans.front() });
+        drain(socket);
+    });
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    session_t session(scheduler);
+    session.connect(endpoint(port)).get();
+
+    auto channel = session.invoke<event_type>(std::string("event")).get();
+    auto pending = channel.rx.recv();
+
+    channel.cancel().get();
+
+    EXPECT_THROW(pending.get(), std::system_error);
+    EXPECT_EQ(0u, session.load());
+
+    const auto types = frames.get();
+    ASSERT_EQ(2u, types.size());
+    EXPECT_EQ(cocaine::io::event_traits<event_type>::id, types[0]);
+    EXPECT_EQ(1u, types[1]);
+
+    // The response sent before the service handled the cancellation is dropped.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (session.orphans() == 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(1u, session.orphans());
+}
+
+TEST(session_t, CancelsAbandonedChannel) {
+    typedef cocaine::io::app::enqueue event_type;
+
+    std::promise<std::vector<std::uint64_t>> received;
+    auto frames = received.get_future();
+
+    const std::uint16_t port = util::port();
+    util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+        asio::ip::tcp::socket socket(loop);
+        acceptor.accept(socket);
+
+        std::vector<std::uint64_t> types;
+        receive(socket, 2, &types);
+        received.set_value(types);
+
+        drain(socket);
+    });
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    session_t session(scheduler);
+    session.cancel_abandoned(true);
+    session.connect(endpoint(port)).get();
+
+    // The channel is dropped before the service has finished it.
+    session.invoke<event_type>(std::string("event")).get();
+
+    const auto types = frames.get();
+    ASSERT_EQ(2u, types.size());
+    EXPECT_EQ(1u, types[1]);
+    EXPECT_EQ(0u, session.load());
+}
+
+TEST(basic_session_t, ConnectsOverLocalSocket) {
+    const std::string path = "/tmp/cocaine-framework-test-" + std::to_string(::getpid()) + ".sock";
+    ::unlink(path.c_str());
+
+    detail::loop_t io;
+    asio::local::stream_protocol::acceptor acceptor(io, asio::local::stream_protocol::endpoint(path));
+    std::thread server([&] {
+        asio::local::stream_protocol::socket socket(io);
+        acceptor.accept(socket);
+
+        reply(socket, receive(socket, 1));
+        drain(socket);
+    });
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    auto session = std::make_shared<basic_session_t>(scheduler);
+    ASSERT_EQ(std::error_code(), session->connect(basic_session_t::local_endpoint_type(path)).get());
+    EXPECT_TRUE(session->connected());
+    EXPECT_FALSE(session->endpoint());
+
+    {
+        auto invoke = session->invoke(&encode).get();
+        EXPECT_NO_THROW(std::get<1>(invoke)->recv().get());
+    }
+
+    session->cancel();
+
+    server.join();
+    ::unlink(path.c_str());
+}
+
+TEST(basic_session_t, ReplaysIdempotentInvocationsAfterDisconnect) {
+    std::promise<std::vector<std::uint64_t>> received;
+    std::promise<std::vector<std::uint64_t>> replayed;
+    auto first = received.get_future();
+    auto second = replayed.get_future();
+
+    const std::uint16_t port = util::port();
+    util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+        {
+            // Receives all invocations, but breaks the connection without responding.
+            asio::ip::tcp::socket socket(loop);
+            acceptor.accept(socket);
+            received.set_value(receive(socket, 4));
+        }
+
+        // The replayed invocations come first, followed by the one made after reconnecting.
+        asio::ip::tcp::socket socket(loop);
+        acceptor.accept(socket);
+
+        const auto spans = receive(socket, 4);
+        replayed.set_value(spans);
+
+        reply(socket, spans);
+        drain(socket);
+    });
+
+    util::client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    auto session = std::make_shared<basic_session_t>(scheduler);
+    session->replay(true);
+
+    auto disconnected = std::make_shared<std::promise<std::error_code>>();
+    auto broken = disconnected->get_future();
+    session->disconnect_handler([disconnected](const std::error_code& ec) {
+        disconnected->set_value(ec);
+    });
+
+    ASSERT_EQ(std::error_code(), session->connect(endpoint(port)).get());
+
+    std::vector<basic_session_t::invoke_result> idempotent;
+    for (int i = 0; i < 3; ++i) {
+        idempotent.push_back(session->invoke(&encode, std::chrono::milliseconds::zero(), true).get());
+    }
+
+    auto regular = session->invoke(&encode).get();
+
+    const auto sent = first.get();
+    ASSERT_EQ(4u, sent.size());
+    EXPECT_TRUE(broken.get());
+
+    // Only the idempotent invocations survive the broken connection.
+    EXPECT_THROW(std::get<1>(regular)->recv().get(), std::system_error);
+    EXPECT_EQ(3u, session->load());
+
+    ASSERT_EQ(std::error_code(), session->connect(endpoint(port)).get());
+    auto fresh = session->invoke(&encode).get();
+
+    // The replayed frames keep their spans and precede the frames of new invocations, which keep
+    // increasing.
+    const auto spans = second.get();
+    ASSERT_EQ(4u, spans.size());
+    EXPECT_EQ(std::vector<std::uint64_t>(sent.begin(), sent.begin() + 3), std::vector<std::uint64_t>(spans.begin(), spans.begin() + 3));
+    EXPECT_LT(sent.back(), spans.back());
+
+    for (std::size_t id = 0; id < idempotent.size(); ++id) {
+        EXPECT_EQ(spans[id], std::get<1>(idempotent[id])->recv().get().span());
+    }
+
+    EXPECT_EQ(spans.back(), std::get<1>(fresh)->recv().get().span());
+
+    // Revokes the channels, so the cancelled session hangs up.
+    idempotent.clear();
+    regular = basic_session_t::invoke_result();
+    fresh = basic_session_t::invoke_result();
+
+    session->cancel();
+}
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <system_error>
+
+#include <boost/thread/barrier.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <asio/error.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/shared_state.hpp>
+
+using namespace cocaine::framework;
+
+using namespace testing;
+
+namespace {
+
+decoded_message
+make_message() {
+    return decoded_message(boost::none);
+}
+
+} // namespace
+
+TEST(shared_state_t, ExpiresPendingRequest) {
+    shared_state_t state;
+
+    std::uint64_t ticket;
+    auto future = state.get(ticket);
+
+    EXPECT_TRUE(state.expire(asio::error::timed_out, ticket));
+    EXPECT_THROW(future.get(), std::system_error);
+
+    // The message arriving too late is dropped, the state stays broken.
+    state.put(make_message());
+    EXPECT_THROW(state.get().get(), std::system_error);
+}
+
+TEST(shared_state_t, ExpireLosesToReceivedMessage) {
+    shared_state_t state;
+
+    std::uint64_t ticket;
+    auto future = state.get(ticket);
+    state.put(make_message());
+
+    // The deadline has fired while the message was being delivered.
+    EXPECT_FALSE(state.expire(asio::error::timed_out, ticket));
+    EXPECT_NO_THROW(future.get());
+
+    // The state is intact, so the following messages are still received.
+    state.put(make_message());
+    EXPECT_NO_THROW(state.get().get());
+}
+
+TEST(shared_state_t, ExpireLosesToQueuedMessage) {
+    shared_state_t state;
+    state.put(make_message());
+
+    std::uint64_t ticket;
+    auto future = state.get(ticket);
+
+    EXPECT_FALSE(state.expire(asio::error::timed_out, ticket));
+    EXPECT_NO_THROW(future.get());
+}
+
+TEST(shared_state_t, StaleTicketDoesNotBreakNextRequest) {
+    shared_state_t state;
+
+    std::uint64_t first;
+    auto future = state.get(first);
+    state.put(make_message());
+    EXPECT_NO_THROW(future.get());
+
+    std::uint64_t second;
+    future = state.get(second);
+    EXPECT_LT(first, second);
+
+    // The deadline of the first request fires after the second one has been made.
+    EXPECT_FALSE(state.expire(asio::error::timed_out, first));
+
+    state.put(make_message());
+    EXPECT_NO_THROW(future.get());
+}
+
+TEST(shared_state_t, BrokenConnectionWinsOverDeadline) {
+    shared_state_t state;
+
+    std::uint64_t ticket;
+    auto future = state.get(ticket);
+    state.put(asio::error::connection_reset);
+
+    EXPECT_FALSE(state.expire(asio::error::timed_out, ticket));
+
+    try {
+        future.get();
+        FAIL() << "the request must fail";
+    } catch (const std::system_error& err) {
+        EXPECT_EQ(std::error_code(asio::error::connection_reset), err.code());
+    }
+}
+
+TEST(shared_state_t, ExpireRacesWithMessage) {
+    // Either the message or the deadline wins, but the request is never both fulfilled and
+    // expired, nor left hanging.
+    for (int round = 0; round < 1000; ++round) {
+        shared_state_t state;
+
+        std::uint64_t ticket;
+        auto future = state.get(ticket);
+
+        std::atomic<bool> expired(false);
+        boost::barrier barrier(2);
+
+        boost::thread thread([&] {
+            barrier.wait();
+            expired = state.expire(asio::error::timed_out, ticket);
+        });
+
+        barrier.wait();
+        state.put(make_message());
+        thread.join();
+
+        if (expired) {
+            EXPECT_THROW(future.get(), std::system_error);
+        } else {
+            EXPECT_NO_THROW(future.get());
+        }
+    }
+}
@@ -0,0 +1,211 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/timer_wheel.hpp>
+
+#include "../../util/net.hpp"
+
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+using namespace testing::util;
+
+namespace {
+
+/// Milliseconds passed since the fake epoch.
+std::atomic<std::uint64_t> elapsed(0);
+
+timer_wheel_t::clock_type::time_point
+fake_now() {
+    return timer_wheel_t::clock_type::time_point(std::chrono::milliseconds(elapsed.load()));
+}
+
+typedef std::shared_ptr<std::atomic<bool>> flag_type;
+
+/// Drives the timer wheel through the fake time, while the wheel runs on the client loop.
+///
+/// The loop timer of the wheel is still real, so it wakes up within a near level span of the real
+/// time after the fake time is moved.
+class driver_t {
+    client_t client;
+    std::vector<std::shared_ptr<deadline_t>> deadlines;
+
+public:
+    std::shared_ptr<timer_wheel_t> wheel;
+    /// The current fake tick.
+    std::uint64_t now;
+
+    driver_t() :
+        now(0)
+    {
+        elapsed = 0;
+        wheel = std::make_shared<timer_wheel_t>(client.loop(), &fake_now);
+    }
+
+    ~driver_t() {
+        deadlines.clear();
+        wheel.reset();
+    }
+
+    /// Schedules a deadline expiring at the given tick, which raises the returned flag.
+    flag_type
+    at(std::uint64_t expires) {
+        return at(expires, deadlines);
+    }
+
+    /// Same as above, but the deadline is owned by the caller.
+    flag_type
+    at(std::uint64_t expires, std::vector<std::shared_ptr<deadline_t>>& owner) {
+        auto flag = std::make_shared<std::atomic<bool>>(false);
+
+        // The wheel adds one tick to the timeout, because the current tick has partially passed.
+        owner.push_back(wheel->schedule(std::chrono::milliseconds(expires - now - 1), [flag] {
+            *flag = true;
+        }));
+
+        return flag;
+    }
+
+    /// Moves the fake time to the given tick without waiting for the wheel.
+    void
+    advance(std::uint64_t tick) {
+        now = tick;
+        elapsed = tick;
+    }
+
+    /// Moves the fake time to the given tick and waits until the wheel has processed it.
+    ///
+    /// A deadline expiring at the tick itself is used as a witness: the wheel runs the callbacks of
+    /// all deadlines expired by a tick together, so the ones due later can be checked after it.
+    void
+    run_until(std::uint64_t tick) {
+        if (tick <= now) {
+            return;
+        }
+
+        const auto witness = at(tick);
+        advance(tick);
+        ASSERT_TRUE(wait(witness));
+    }
+
+    static
+    bool
+    wait(const flag_type& flag) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!*flag && std::chrono::steady_clock::now() < deadline) {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+        }
+
+        return *flag;
+    }
+};
+
+} // namespace
+
+TEST(timer_wheel_t, FiresAtLevelBoundaries) {
+    driver_t driver;
+
+    // Boundaries of the near level and of each outer level, beyond the last of which deadlines
+    // are clamped.
+    const std::vector<std::uint64_t> ticks{
+        1, 255, 256, 257,
+        (1 << 14) - 1, 1 << 14, (1 << 14) + 1,
+        (1 << 20) - 1, 1 << 20, (1 << 20) + 1,
+        (1 << 26) - 1, 1 << 26, (1 << 26) + 1
+    };
+
+    std::vector<flag_type> flags;
+    for (auto tick : ticks) {
+        flags.push_back(driver.at(tick));
+    }
+
+    for (std::size_t id = 0; id < ticks.size(); ++id) {
+        driver.run_until(ticks[id] - 1);
+        EXPECT_FALSE(*flags[id]) << "deadline at " << ticks[id] << " has fired early";
+
+        driver.run_until(ticks[id]);
+        EXPECT_TRUE(*flags[id]) << "deadline at " << ticks[id] << " has not fired";
+    }
+
+    EXPECT_EQ(0u, driver.wheel->pending());
+}
+
+TEST(timer_wheel_t, ClampsBeyondOutermostLevel) {
+    driver_t driver;
+
+    const std::uint64_t tick = (std::uint64_t(1) << 27) + 1;
+    const auto flag = driver.at(tick);
+
+    // The deadline waits in the farthest slot of the outermost level until it comes within the
+    // span, passing the tick the unclamped slot index would have fired it at.
+    driver.run_until((std::uint64_t(1) << 26) + 1);
+    EXPECT_FALSE(*flag);
+
+    driver.run_until(tick - 1);
+    EXPECT_FALSE(*flag);
+
+    driver.run_until(tick);
+    EXPECT_TRUE(*flag);
+}
+
+TEST(timer_wheel_t, RearmsAfterCancel) {
+    driver_t driver;
+
+    std::vector<std::shared_ptr<deadline_t>> cancelled;
+    const auto first = driver.at(10, cancelled);
+    cancelled.front()->cancel();
+
+    // The loop timer has been disarmed, so the next deadline must arm it again. No witness is
+    // scheduled here, because it would arm the timer itself.
+    EXPECT_EQ(0u, driver.wheel->pending());
+
+    const auto second = driver.at(20);
+    driver.advance(20);
+
+    EXPECT_TRUE(driver_t::wait(second));
+    EXPECT_FALSE(*first);
+}
+
+TEST(timer_wheel_t, DestroyedDeadlineDoesNotFire) {
+    driver_t driver;
+
+    std::vector<std::shared_ptr<deadline_t>> dropped;
+    const auto flag = driver.at(10, dropped);
+    dropped.clear();
+
+    EXPECT_EQ(0u, driver.wheel->pending());
+
+    driver.run_until(20);
+    EXPECT_FALSE(*flag);
+}
+
+TEST(timer_wheel_t, SkipsIdlePeriod) {
+    driver_t driver;
+
+    std::vector<std::shared_ptr<deadline_t>> cancelled;
+    const auto idle = driver.at(100, cancelled);
+    cancelled.front()->cancel();
+
+    // The wheel has nothing pending, so the next deadline starts from the current tick instead of
+    // processing the four billions of ticks passed meanwhile, which would take seconds.
+    const std::uint64_t origin = std::uint64_t(1) << 32;
+    driver.advance(origin);
+
+    const auto begin = std::chrono::steady_clock::now();
+    const auto flag = driver.at(origin + 10);
+
+    driver.run_until(origin + 9);
+    EXPECT_FALSE(*flag);
+
+    driver.run_until(origin + 10);
+    EXPECT_TRUE(*flag);
+    EXPECT_FALSE(*idle);
+
+    EXPECT_LT(std::chrono::steady_clock::now() - begin, std::chrono::seconds(2));
+}
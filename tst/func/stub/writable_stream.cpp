@@ -0,0 +1,270 @@
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <asio/local/connect_pair.hpp>
+#include <asio/local/stream_protocol.hpp>
+#include <asio/read.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/hpack/header.hpp>
+#include <cocaine/hpack/static_table.hpp>
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+
+#include <cocaine/framework/detail/decoder.hpp>
+#include <cocaine/framework/detail/writable_stream.hpp>
+
+#include "../../util/net.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+
+namespace {
+
+typedef asio::local::stream_protocol protocol_type;
+typedef writable_stream_t<protocol_type> stream_type;
+
+/// Connected pair of sockets: the stream writes to the first one, the test reads from the second.
+struct pair_t {
+    std::shared_ptr<protocol_type::socket> socket;
+    protocol_type::socket peer;
+
+    explicit
+    pair_t(loop_t& loop) :
+        socket(std::make_shared<protocol_type::socket>(loop)),
+        peer(loop)
+    {
+        asio::local::connect_pair(*socket, peer);
+    }
+
+    /// Reads exactly the given number of bytes from the peer.
+    std::string
+    read(std::size_t size) {
+        std::string result(size, '\0');
+        asio::read(peer, asio::buffer(&result[0], size));
+        return result;
+    }
+};
+
+/// Returns a handler that fulfills the given promise with the write result.
+stream_type::handler_type
+notify(std::promise<std::error_code>& promise) {
+    return [&promise](const std::error_code& ec) {
+        promise.set_value(ec);
+    };
+}
+
+/// Wraps the given data into a frame, which refers to it without copying.
+frame_t
+frame(const std::string& data) {
+    return frame_t(data.data(), 0, { payload_t(nullptr, data.data(), data.size()) });
+}
+
+} // namespace
+
+TEST(writable_stream_t, WritesBurstInOrder) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+
+    std::vector<std::string> messages;
+    std::string expected;
+    for (int id = 0; id < 32; ++id) {
+        messages.push_back(std::string(100 + id, 'a' + id % 26));
+        expected += messages.back();
+    }
+
+    std::vector<std::promise<std::error_code>> written(messages.size());
+
+    {
+        // Messages queued while the loop is busy are all written at once after it is released.
+        util::blocker_t blocker(client.loop());
+
+        for (std::size_t id = 0; id < messages.size(); ++id) {
+            stream->write(frame(messages[id]), notify(written[id]));
+        }
+    }
+
+    EXPECT_EQ(expected, pair.read(expected.size()));
+
+    for (auto& promise : written) {
+        EXPECT_EQ(std::error_code(), promise.get_future().get());
+    }
+}
+
+TEST(writable_stream_t, HoldsCorkedMessagesUntilEnoughBytes) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+    stream->cork(100, std::chrono::milliseconds(500));
+
+    const std::string first(60, 'a');
+    const std::string second(60, 'b');
+
+    std::promise<std::error_code> written[2];
+
+    stream->write(frame(first), notify(written[0]));
+
+    auto pending = written[0].get_future();
+    EXPECT_EQ(std::future_status::timeout, pending.wait_for(std::chrono::milliseconds(50)));
+    EXPECT_EQ(0u, pair.peer.available());
+
+    // The cork threshold is reached, so both messages are written immediately.
+    stream->write(frame(second), notify(written[1]));
+
+    EXPECT_EQ(first + second, pair.read(first.size() + second.size()));
+    EXPECT_EQ(std::error_code(), pending.get());
+    EXPECT_EQ(std::error_code(), written[1].get_future().get());
+}
+
+TEST(writable_stream_t, FlushesCorkedMessagesAfterLatency) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+    stream->cork(1024 * 1024, std::chrono::milliseconds(50));
+
+    const std::string message(10, 'a');
+
+    std::promise<std::error_code> written;
+
+    const auto start = std::chrono::steady_clock::now();
+    stream->write(frame(message), notify(written));
+
+    EXPECT_EQ(std::error_code(), written.get_future().get());
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    EXPECT_EQ(message, pair.read(message.size()));
+}
+
+TEST(writable_stream_t, FailsQueuedMessagesAfterBrokenWrite) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+
+    pair.peer.close();
+
+    const std::string message(10, 'a');
+
+    std::promise<std::error_code> first;
+    stream->write(frame(message), notify(first));
+    EXPECT_TRUE(first.get_future().get());
+
+    // The stream remembers the error, failing subsequent writes without touching the socket.
+    std::promise<std::error_code> second;
+    stream->write(frame(message), notify(second));
+    EXPECT_TRUE(second.get_future().get());
+}
+
+TEST(writable_stream_t, ThrottlesAboveHighWatermark) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+    stream->watermarks(1024, 512);
+
+    // The peer does not read yet, so the large message gets stuck in the socket.
+    const std::string large(8 * 1024 * 1024, 'a');
+    const std::string small(100, 'b');
+
+    std::promise<std::error_code> written[2];
+    stream->write(frame(large), notify(written[0]));
+    stream->write(frame(small), notify(written[1]));
+
+    EXPECT_EQ(large.size() + small.size(), stream->queued());
+
+    std::promise<std::error_code> drained;
+    stream->writable(notify(drained));
+
+    auto writable = drained.get_future();
+    EXPECT_EQ(std::future_status::timeout, writable.wait_for(std::chrono::milliseconds(50)));
+
+    EXPECT_EQ(large + small, pair.read(large.size() + small.size()));
+
+    EXPECT_EQ(std::error_code(), writable.get());
+    EXPECT_EQ(std::error_code(), written[0].get_future().get());
+    EXPECT_EQ(std::error_code(), written[1].get_future().get());
+}
+
+TEST(writable_stream_t, ReleasesWaitersWhenWatermarksAreReset) {
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+    stream->watermarks(1024, 512);
+
+    const std::string large(8 * 1024 * 1024, 'a');
+
+    std::promise<std::error_code> written;
+    stream->write(frame(large), notify(written));
+
+    std::promise<std::error_code> drained;
+    stream->writable(notify(drained));
+
+    auto writable = drained.get_future();
+    EXPECT_EQ(std::future_status::timeout, writable.wait_for(std::chrono::milliseconds(50)));
+
+    // Disabling throttling releases the waiters, although nothing has been written yet.
+    stream->watermarks(0, 0);
+    EXPECT_EQ(std::error_code(), writable.get());
+
+    // Breaks the stuck write, so the loop can finish.
+    pair.peer.close();
+    EXPECT_TRUE(written.get_future().get());
+}
+
+TEST(writable_stream_t, SendsRepeatedHeadersAsTableReferences) {
+    typedef cocaine::io::streaming<std::string>::choke event_type;
+
+    util::client_t client;
+    pair_t pair(client.loop());
+
+    auto stream = std::make_shared<stream_type>(pair.socket);
+
+    const std::uint64_t value = 0x0123456789abcdef;
+
+    std::promise<std::error_code> written[2];
+    for (auto& promise : written) {
+        auto frame = encode_constant<event_type>(1);
+        frame.attach({ hpack::header_t::create<hpack::headers::trace_id<>>(hpack::header::pack(value)) });
+        stream->write(std::move(frame), notify(promise));
+    }
+
+    for (auto& promise : written) {
+        EXPECT_EQ(std::error_code(), promise.get_future().get());
+    }
+
+    const auto data = pair.read(pair.peer.available());
+
+    decoder_t decoder;
+    std::size_t offset = 0;
+    std::vector<std::size_t> sizes;
+    for (int id = 0; id < 2; ++id) {
+        std::error_code ec;
+        decoded_message message(boost::none);
+        const auto consumed = decoder.decode(data.data() + offset, data.size() - offset, message, ec);
+        ASSERT_EQ(std::error_code(), ec);
+
+        const auto header = message.get_header<hpack::headers::trace_id<>>();
+        ASSERT_TRUE(header);
+        EXPECT_EQ(value, hpack::header::unpack<std::uint64_t>(header->value()));
+
+        offset += consumed;
+        sizes.push_back(consumed);
+    }
+
+    EXPECT_EQ(data.size(), offset);
+
+    // The second frame refers to the header table entry instead of repeating the header.
+    EXPECT_LT(sizes[1], sizes[0]);
+}
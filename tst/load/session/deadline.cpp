@@ -0,0 +1,68 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/timer_wheel.hpp>
+
+#include "../config.hpp"
+#include "../../util/net.hpp"
+
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+TEST(load, session_deadline) {
+    uint iters = 1000000;
+    uint timeout = 100;
+    load_config("load.session.deadline", iters, timeout);
+
+    util::client_t client;
+    auto wheel = std::make_shared<detail::timer_wheel_t>(client.loop());
+
+    std::vector<std::shared_ptr<detail::deadline_t>> deadlines;
+    deadlines.reserve(iters);
+
+    std::atomic<uint> fired(0);
+
+    // Most of the invocations complete in time, cancelling their deadlines.
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        deadlines.push_back(wheel->schedule(std::chrono::milliseconds(timeout + id % timeout), [&] {
+            ++fired;
+        }));
+    }
+    const auto scheduled = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        if (id % 100 != 0) {
+            deadlines[id]->cancel();
+        }
+    }
+    const auto cancelled = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    const uint expected = (iters + 99) / 100;
+    EXPECT_EQ(expected, wheel->pending());
+
+    // The rest expire.
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(10 * timeout);
+    while (fired < expected && std::chrono::steady_clock::now() < until) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    EXPECT_EQ(expected, fired);
+    EXPECT_EQ(0u, wheel->pending());
+
+    fprintf(stdout, "%8.2fns schedule, %8.2fns cancel per deadline\n", scheduled, cancelled);
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/streaming.hpp>
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+
+#include "../config.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+namespace testing { namespace load { namespace encoding {
+
+typedef io::streaming<std::string>::chunk chunk_type;
+
+double
+elapsed(std::chrono::high_resolution_clock::time_point start, uint iters) {
+    return std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+}
+
+}}} // namespace testing::load::encoding
+
+TEST(load, encoder_pooled) {
+    uint iters = 1000000;
+    load_config("load.encoder.pooled", iters);
+
+    for (std::size_t size = 64; size <= 16384; size *= 4) {
+        const std::string payload(size, 'x');
+
+        // Both encoders must produce the same bytes.
+        {
+            const io::encoded<encoding::chunk_type> message(42, payload);
+            const auto frame = encode_pooled<encoding::chunk_type>(42, payload);
+
+            std::vector<asio::const_buffer> buffers;
+            frame.gather(buffers);
+
+            std::string encoded;
+            for (const auto& buffer : buffers) {
+                encoded.append(asio::buffer_cast<const char*>(buffer), asio::buffer_size(buffer));
+            }
+
+            EXPECT_EQ(std::string(message.data(), message.size()), encoded);
+        }
+
+        std::size_t checksum = 0;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint id = 0; id < iters; ++id) {
+            const io::encoded<encoding::chunk_type> message(id, payload);
+            checksum += message.size();
+        }
+        const auto growing = encoding::elapsed(start, iters);
+
+        start = std::chrono::high_resolution_clock::now();
+        for (uint id = 0; id < iters; ++id) {
+            checksum -= encode_pooled<encoding::chunk_type>(id, payload).size();
+        }
+        const auto pooled = encoding::elapsed(start, iters);
+
+        EXPECT_EQ(0u, checksum);
+
+        fprintf(stdout, "%5zuB : %8.2fns growing, %8.2fns pooled per message\n", size, growing, pooled);
+    }
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <asio/read.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/locator.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+#include <cocaine/framework/scheduler.hpp>
+
+#include <cocaine/framework/detail/basic_session.hpp>
+#include <cocaine/framework/detail/loop.hpp>
+
+#include "../config.hpp"
+#include "../../util/net.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+TEST(load, session_invoke) {
+    uint iters = 100000;
+    uint max = 8;
+    load_config("load.session.invoke", iters, max);
+
+    for (uint threads = 1; threads <= max; threads *= 2) {
+        const std::uint16_t port = util::port();
+        util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+            asio::ip::tcp::socket socket(loop);
+            acceptor.accept(socket);
+
+            // Swallow all invocations until the client hangs up.
+            std::error_code ec;
+            std::vector<char> buffer(65536);
+            while (!ec) {
+                socket.read_some(asio::buffer(buffer), ec);
+            }
+        });
+
+        util::client_t client;
+        event_loop_t loop { client.loop() };
+        scheduler_t scheduler(loop);
+
+        auto session = std::make_shared<basic_session_t>(scheduler);
+        const basic_session_t::endpoint_type endpoint(boost::asio::ip::address_v4::loopback(), port);
+        ASSERT_EQ(std::error_code(), session->connect(endpoint).get());
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        std::vector<std::thread> workers;
+        for (uint id = 0; id < threads; ++id) {
+            workers.emplace_back([&] {
+                for (uint i = 0; i < iters / threads; ++i) {
+                    // Both the sender and the receiver are dropped here, revoking the channel.
+                    session->invoke([](std::uint64_t span) -> frame_t {
+                        return encode_pooled<io::locator::resolve>(span, std::string("invoke"));
+                    }).get();
+                }
+            });
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        const auto elapsed = std::chrono::duration<
+            double,
+            std::chrono::milliseconds::period
+        >(std::chrono::high_resolution_clock::now() - start).count();
+
+        fprintf(stdout, "%2u threads : %10.3fms, %10.0f invokes/s\n", threads, elapsed, 1000.0 * iters / elapsed);
+
+        session->cancel();
+    }
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <asio/local/stream_protocol.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/locator.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+#include <cocaine/framework/scheduler.hpp>
+
+#include <cocaine/framework/detail/basic_session.hpp>
+#include <cocaine/framework/detail/loop.hpp>
+
+#include "../config.hpp"
+#include "../../util/net.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+namespace {
+
+/// Swallows all invocations until the client hangs up.
+template<class Socket>
+void swallow(Socket& socket) {
+    std::error_code ec;
+    std::vector<char> buffer(65536);
+    while (!ec) {
+        socket.read_some(asio::buffer(buffer), ec);
+    }
+}
+
+/// Invokes sequentially, so the result is dominated by the transport round-trip.
+double invoke(basic_session_t& session, uint iters) {
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    for (uint i = 0; i < iters; ++i) {
+        session.invoke([](std::uint64_t span) -> frame_t {
+            return encode_pooled<io::locator::resolve>(span, std::string("local"));
+        }).get();
+    }
+
+    return std::chrono::duration<
+        double,
+        std::chrono::milliseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace
+
+TEST(load, session_local) {
+    uint iters = 100000;
+    load_config("load.session.local", iters);
+
+    double tcp = 0.0;
+    {
+        const std::uint16_t port = util::port();
+        util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+            asio::ip::tcp::socket socket(loop);
+            acceptor.accept(socket);
+            swallow(socket);
+        });
+
+        util::client_t client;
+        event_loop_t loop { client.loop() };
+        scheduler_t scheduler(loop);
+
+        auto session = std::make_shared<basic_session_t>(scheduler);
+        const basic_session_t::endpoint_type endpoint(boost::asio::ip::address_v4::loopback(), port);
+        ASSERT_EQ(std::error_code(), session->connect(endpoint).get());
+
+        tcp = invoke(*session, iters);
+        session->cancel();
+    }
+
+    double local = 0.0;
+    {
+        const std::string path = "/tmp/cocaine-framework-load-" + std::to_string(::getpid()) + ".sock";
+        ::unlink(path.c_str());
+
+        detail::loop_t io;
+        asio::local::stream_protocol::acceptor acceptor(io, asio::local::stream_protocol::endpoint(path));
+        std::thread server([&] {
+            asio::local::stream_protocol::socket socket(io);
+            acceptor.accept(socket);
+            swallow(socket);
+        });
+
+        util::client_t client;
+        event_loop_t loop { client.loop() };
+        scheduler_t scheduler(loop);
+
+        auto session = std::make_shared<basic_session_t>(scheduler);
+        const basic_session_t::local_endpoint_type endpoint(path);
+        ASSERT_EQ(std::error_code(), session->connect(endpoint).get());
+        EXPECT_FALSE(session->endpoint());
+
+        local = invoke(*session, iters);
+        session->cancel();
+
+        server.join();
+        ::unlink(path.c_str());
+    }
+
+    fprintf(stdout, "tcp   : %10.3fms, %10.0f invokes/s\n", tcp, 1000.0 * iters / tcp);
+    fprintf(stdout, "local : %10.3fms, %10.0f invokes/s\n", local, 1000.0 * iters / local);
+}
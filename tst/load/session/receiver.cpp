@@ -0,0 +1,215 @@
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/mpl/at.hpp>
+#include <boost/mpl/int.hpp>
+#include <boost/mpl/size.hpp>
+
+#include <gtest/gtest.h>
+
+#include <msgpack.hpp>
+
+#include <cocaine/idl/primitive.hpp>
+#include <cocaine/idl/streaming.hpp>
+#include <cocaine/traits/tuple.hpp>
+#include <cocaine/traits/vector.hpp>
+#include <cocaine/utility.hpp>
+
+#include <cocaine/framework/receiver.hpp>
+#include <cocaine/framework/unpack.hpp>
+
+#include <cocaine/framework/detail/basic_session.hpp>
+
+#include "../config.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+namespace testing { namespace load { namespace unpacking {
+
+/// Transforms a typelist sequence into an unordered map using the given metafunction.
+template<class Sequence, class F>
+struct to_map {
+    typedef Sequence sequence_type;
+    typedef typename F::result_type value_type;
+    static constexpr std::size_t size = boost::mpl::size<sequence_type>::value;
+
+    typedef std::unordered_map<std::uint64_t, value_type> result_type;
+
+private:
+    template<class IndexSequence>
+    struct helper;
+
+    template<size_t... Index>
+    struct helper<index_sequence<Index...>> {
+        static inline
+        result_type
+        apply() {
+            return result_type {{
+                Index,
+                F::template apply<typename boost::mpl::at<sequence_type, boost::mpl::int_<Index>>::type>()
+            }...};
+        }
+    };
+
+public:
+    static
+    result_type make() {
+        return helper<typename make_index_sequence<size>::type>::apply();
+    }
+};
+
+/// The metafunction to be used to fill the map with type-erased unpackers.
+template<class Session, class Result>
+struct unpacker_factory {
+    typedef Result result_type;
+
+    template<class T>
+    static inline
+    result_type
+    apply() {
+        return detail::unpacker<T, Session>();
+    }
+};
+
+/// Unpacks the given arguments into the object, which data is owned by the zone.
+template<class T>
+msgpack::object
+args(const T& value, msgpack::sbuffer& buffer, msgpack::zone& zone) {
+    msgpack::pack(buffer, value);
+
+    msgpack::object object;
+    std::size_t offset = 0;
+    msgpack::unpack(buffer.data(), buffer.size(), &offset, &zone, &object);
+    return object;
+}
+
+/// Measures the average cost of converting messages with the given ids into the receiver result
+/// using both the type-erased map and the compile-time dispatch.
+template<class Tag>
+void
+measure(const char* name, uint iters, const std::vector<std::pair<std::uint64_t, msgpack::object>>& messages) {
+    typedef typename detail::variant_of<Tag>::type result_type;
+    typedef std::function<result_type(const msgpack::object&)> unpacker_type;
+
+    const auto unpackers = to_map<
+        typename result_type::types,
+        unpacker_factory<basic_session_t, unpacker_type>
+    >::make();
+
+    typedef detail::dispatch<
+        typename result_type::types,
+        detail::unpacker_invoker<basic_session_t, result_type>
+    > dispatch_type;
+
+    std::size_t checksum = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        const auto& message = messages[id % messages.size()];
+        checksum += unpackers.find(message.first)->second(message.second).which();
+    }
+    const auto map = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        const auto& message = messages[id % messages.size()];
+        checksum -= dispatch_type::apply(message.first, message.second).which();
+    }
+    const auto dispatch = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    EXPECT_EQ(0u, checksum);
+
+    fprintf(stdout, "%-10s: %8.2fns map, %8.2fns dispatch per recv\n", name, map, dispatch);
+}
+
+/// Measures the average cost of unpacking the given encoded arguments into the tuple through the
+/// object tree and directly.
+template<class T>
+void
+measure_direct(const char* name, uint iters, const msgpack::sbuffer& buffer) {
+    std::size_t checksum = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        msgpack::zone zone;
+        msgpack::object object;
+        std::size_t offset = 0;
+        msgpack::unpack(buffer.data(), buffer.size(), &offset, &zone, &object);
+
+        T result;
+        io::type_traits<T>::unpack(object, result);
+        checksum += std::get<0>(result).size();
+    }
+    const auto tree = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (uint id = 0; id < iters; ++id) {
+        T result;
+        const char* it = buffer.data();
+        ASSERT_TRUE(detail::direct_unpack<T>::unpack(it, buffer.data() + buffer.size(), result));
+        checksum -= std::get<0>(result).size();
+    }
+    const auto direct = std::chrono::duration<
+        double,
+        std::chrono::nanoseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count() / iters;
+
+    EXPECT_EQ(0u, checksum);
+
+    fprintf(stdout, "%-10s: %8.2fns object tree, %8.2fns direct per message\n", name, tree, direct);
+}
+
+}}} // namespace testing::load::unpacking
+
+TEST(load, receiver_dispatch) {
+    uint iters = 1000000;
+    load_config("load.receiver.dispatch", iters);
+
+    msgpack::zone zone;
+    msgpack::sbuffer value;
+    msgpack::sbuffer choke;
+
+    const auto chunk = unpacking::args(std::vector<std::string>{ "le message" }, value, zone);
+    const auto empty = unpacking::args(std::vector<std::string>{}, choke, zone);
+
+    unpacking::measure<io::primitive_tag<std::string>>("primitive", iters, {
+        { 0, chunk }
+    });
+
+    unpacking::measure<io::streaming_tag<std::string>>("streaming", iters, {
+        { 0, chunk }, { 0, chunk }, { 0, chunk }, { 2, empty }
+    });
+}
+
+TEST(load, receiver_direct) {
+    uint iters = 1000000;
+    load_config("load.receiver.direct", iters);
+
+    msgpack::sbuffer chunk;
+    msgpack::pack(chunk, std::vector<std::string>{ std::string(4096, 'x') });
+
+    msgpack::sbuffer listing;
+    msgpack::pack(listing, std::vector<std::vector<std::string>>{
+        std::vector<std::string>(64, "le message")
+    });
+
+    unpacking::measure_direct<std::tuple<std::string>>("chunk", iters, chunk);
+    unpacking::measure_direct<std::tuple<std::vector<std::string>>>("listing", iters, listing);
+}
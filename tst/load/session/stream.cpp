@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <asio/read.hpp>
+#include <asio/write.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/locator.hpp>
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+#include <cocaine/framework/message.hpp>
+#include <cocaine/framework/scheduler.hpp>
+
+#include <cocaine/framework/detail/basic_session.hpp>
+#include <cocaine/framework/detail/buffer.hpp>
+#include <cocaine/framework/detail/decoder.hpp>
+#include <cocaine/framework/detail/loop.hpp>
+
+#include "../config.hpp"
+#include "../../util/net.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+
+using namespace testing;
+using namespace testing::load;
+
+namespace testing { namespace load { namespace stream {
+
+/// Size of a single socket read emulated by the decoder benchmark.
+const std::size_t READ_SIZE = 65536;
+
+/// Builds a streaming chunk frame `[span, 0, [str]]` with the payload of the given size.
+std::vector<char>
+chunk(std::uint64_t span, std::uint32_t size) {
+    const char header[] = {
+        '\x93', static_cast<char>(span), '\x00', '\x91', '\xdb',
+        static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+        static_cast<char>(size >> 8), static_cast<char>(size)
+    };
+
+    std::vector<char> frame(header, header + sizeof(header));
+    frame.resize(frame.size() + size, 'x');
+    return frame;
+}
+
+/// Builds a streaming choke frame `[span, 2, []]`.
+std::vector<char>
+choke(std::uint64_t span) {
+    return std::vector<char> { '\x93', static_cast<char>(span), '\x02', '\x90' };
+}
+
+double
+elapsed(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<
+        double,
+        std::chrono::milliseconds::period
+    >(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+}}} // namespace testing::load::stream
+
+TEST(load, decoder_stream) {
+    uint max = 64;
+    load_config("load.decoder.stream", max);
+
+    for (std::uint32_t mb = 1; mb <= max; mb *= 2) {
+        const auto frame = stream::chunk(1, mb << 20);
+
+        auto buffer = std::make_shared<detail::buffer_t>(frame.size());
+        std::memcpy(buffer->data(), frame.data(), frame.size());
+
+        // Copying decoder, which parses the frame from its start after each read.
+        detail::decoder_t copying;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (std::size_t received = 0; received < frame.size();) {
+            received = std::min(received + stream::READ_SIZE, frame.size());
+
+            decoded_message message(boost::none);
+            std::error_code ec;
+            copying.decode(frame.data(), received, message, ec);
+        }
+        const auto copying_elapsed = stream::elapsed(start);
+
+        // Incremental in place decoder.
+        detail::decoder_t incremental;
+        start = std::chrono::high_resolution_clock::now();
+        for (std::size_t received = 0; received < frame.size();) {
+            received = std::min(received + stream::READ_SIZE, frame.size());
+
+            decoded_message message(boost::none);
+            std::error_code ec;
+            incremental.decode(buffer, 0, received, message, ec);
+        }
+        const auto incremental_elapsed = stream::elapsed(start);
+
+        fprintf(stdout, "%2uMB : %10.3fms copying, %8.3fms incremental, x%.1f\n",
+            mb, copying_elapsed, incremental_elapsed, copying_elapsed / incremental_elapsed);
+    }
+}
+
+TEST(load, session_stream) {
+    uint iters = 16;
+    uint max = 64;
+    load_config("load.session.stream", iters, max);
+
+    for (std::uint32_t mb = 1; mb <= max; mb *= 2) {
+        const auto frame = stream::chunk(1, mb << 20);
+        const auto choke = stream::choke(1);
+
+        const std::uint16_t port = util::port();
+        util::server_t server(port, [&](asio::ip::tcp::acceptor& acceptor, detail::loop_t& loop) {
+            asio::ip::tcp::socket socket(loop);
+            acceptor.accept(socket);
+
+            for (uint id = 0; id < iters; ++id) {
+                asio::write(socket, asio::buffer(frame));
+            }
+            asio::write(socket, asio::buffer(choke));
+
+            // Wait until the client hangs up.
+            std::error_code ec;
+            char byte;
+            while (!ec) {
+                asio::read(socket, asio::buffer(&byte, 1), ec);
+            }
+        });
+
+        util::client_t client;
+        event_loop_t loop { client.loop() };
+        scheduler_t scheduler(loop);
+
+        {
+            auto session = std::make_shared<basic_session_t>(scheduler);
+            const basic_session_t::endpoint_type endpoint(boost::asio::ip::address_v4::loopback(), port);
+            ASSERT_EQ(std::error_code(), session->connect(endpoint).get());
+
+            auto channel = session->invoke([](std::uint64_t span) -> frame_t {
+                return encode_pooled<io::locator::resolve>(span, std::string("stream"));
+            }).get();
+            auto rx = std::get<1>(channel);
+
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (uint id = 0; id < iters; ++id) {
+                EXPECT_EQ(0, rx->recv().get().type());
+            }
+            const auto total = stream::elapsed(start);
+            EXPECT_EQ(2, rx->recv().get().type());
+
+            fprintf(stdout, "%2uMB : %10.3fms, %8.2fMB/s\n", mb, total, 1000.0 * mb * iters / total);
+
+            channel = basic_session_t::invoke_result();
+            rx.reset();
+            session->cancel();
+        }
+    }
+}
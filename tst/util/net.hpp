@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <future>
+#include <memory>
 
 #include <boost/thread/barrier.hpp>
 #include <boost/thread/thread.hpp>
@@ -79,6 +81,42 @@ public:
     }
 };
 
+/// Keeps the loop busy, so the completion of operations started meanwhile is postponed until
+/// released.
+class blocker_t {
+    std::promise<void> gate;
+    bool released;
+
+public:
+    explicit
+    blocker_t(fw::detail::loop_t& loop) :
+        released(false)
+    {
+        auto entered = std::make_shared<std::promise<void>>();
+        auto wait = entered->get_future();
+        std::shared_future<void> gate = this->gate.get_future().share();
+
+        loop.post([entered, gate] {
+            entered->set_value();
+            gate.wait();
+        });
+
+        wait.wait();
+    }
+
+    ~blocker_t() {
+        release();
+    }
+
+    void
+    release() {
+        if (!released) {
+            released = true;
+            gate.set_value();
+        }
+    }
+};
+
 } // namespace util
 
 } // namespace testing